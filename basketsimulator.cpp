@@ -0,0 +1,211 @@
+#include "basketsimulator.h"
+#include "rangetask.h"
+#include "simdkernels.h"
+#include <QAtomicInt>
+#include <QThread>
+#include <QThreadPool>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+namespace {
+const int pathBatch = 64;
+const int assetPadding = 16;
+const double smallestPivot = 1e-12;
+}
+BasketSimulator::BasketSimulator(QObject *parent)
+    : QObject(parent), assets(0), stride(0), threads(0), randomSeed(0), generatorBackend(RandomStream::Philox)
+{
+    pool = new QThreadPool(this);
+    pool->setMaxThreadCount(threadCount());
+}
+void BasketSimulator::setThreadCount(int count)
+{
+    threads = qMax(0, count);
+    pool->setMaxThreadCount(threadCount());
+}
+int BasketSimulator::threadCount() const
+{
+    return threads > 0 ? threads : qMax(1, QThread::idealThreadCount());
+}
+// The covariance is one product of the transposed centred returns with
+// themselves, so it goes through the same blocked kernel as the shocks.
+void BasketSimulator::setHistoricalPrices(const QVector<QVector<double>> &prices)
+{
+    assets = prices.size();
+    stride = (assets + assetPadding - 1) / assetPadding * assetPadding;
+    int length = assets > 0 ? prices[0].size() : 0;
+    for (const QVector<double> &series : prices)
+        length = qMin(length, series.size());
+    const int count = qMax(0, length - 1);
+    lastPrices.resize(assets);
+    drifts.fill(0.0, assets);
+    volatilities.fill(0.0, assets);
+    QVector<double> returns(count * assets);
+    for (int i = 0; i < assets; ++i)
+    {
+        const double *closes = prices[i].constData() + prices[i].size() - length;
+        lastPrices[i] = length > 0 ? closes[length - 1] : 0.0;
+        double mean = 0.0;
+        for (int t = 0; t < count; ++t)
+        {
+            returns[t * assets + i] = log(closes[t + 1] / closes[t]);
+            mean += returns[t * assets + i];
+        }
+        mean = count > 0 ? mean / count : 0.0;
+        double variance = 0.0;
+        for (int t = 0; t < count; ++t)
+        {
+            returns[t * assets + i] -= mean;
+            variance += returns[t * assets + i] * returns[t * assets + i];
+        }
+        variance = count > 0 ? variance / count : 0.0;
+        drifts[i] = mean - variance / 2;
+        volatilities[i] = sqrt(variance);
+    }
+    QVector<double> transposed(assets * count);
+    for (int t = 0; t < count; ++t)
+        for (int i = 0; i < assets; ++i)
+            transposed[i * count + t] = returns[t * assets + i];
+    correlations.fill(0.0, assets * assets);
+    Simd::multiply(transposed.constData(), assets, count, returns.constData(), assets, false, correlations.data());
+    for (int i = 0; i < assets; ++i)
+        for (int j = 0; j < assets; ++j)
+        {
+            double scale = count * volatilities[i] * volatilities[j];
+            correlations[i * assets + j] = i == j ? 1.0 : (scale > 0.0 ? correlations[i * assets + j] / scale : 0.0);
+        }
+    factor.fill(0.0, assets * assets);
+    for (int j = 0; j < assets; ++j)
+    {
+        double pivot = correlations[j * assets + j];
+        for (int k = 0; k < j; ++k)
+            pivot -= factor[j * assets + k] * factor[j * assets + k];
+        if (pivot <= smallestPivot)
+            continue;
+        const double root = sqrt(pivot);
+        factor[j * assets + j] = root;
+        for (int i = j + 1; i < assets; ++i)
+        {
+            double sum = correlations[i * assets + j];
+            for (int k = 0; k < j; ++k)
+                sum -= factor[i * assets + k] * factor[j * assets + k];
+            factor[i * assets + j] = sum / root;
+        }
+    }
+    paddedTranspose.fill(0.0, stride * stride);
+    for (int i = 0; i < assets; ++i)
+        for (int k = 0; k <= i; ++k)
+            paddedTranspose[k * stride + i] = factor[i * assets + k];
+}
+double BasketSimulator::expectedPrice(int asset, int days) const
+{
+    const double volatility = volatilities[asset];
+    return lastPrices[asset] * exp(days * (drifts[asset] + 0.5 * volatility * volatility));
+}
+void BasketSimulator::runParallel(int count, const std::function<void(int, int)> &body, int chunk)
+{
+    int workers = qMin(threadCount(), (count + chunk - 1) / chunk);
+    if (workers <= 1)
+    {
+        if (count > 0)
+            body(0, count);
+        return;
+    }
+    QAtomicInt next(0);
+    for (int t = 0; t < workers; ++t)
+        pool->start(new RangeTask(&next, count, chunk, &body));
+    pool->waitForDone();
+}
+// A batch keeps one stream per path and draws each step's normals into a
+// rows x stride matrix (the padding columns stay zero), so the correlated
+// shocks of the whole batch are a single product with the transposed
+// factor. The results are written as log prices and exponentiated per asset
+// at the end.
+QVector<SimulationResult> BasketSimulator::runHorizons(const QVector<int> &horizons, int numSimulations)
+{
+    QVector<int> sorted = horizons;
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+    while (!sorted.isEmpty() && sorted.first() < 0)
+        sorted.removeFirst();
+    const int columns = sorted.size();
+    QVector<double> logStartPrices(assets);
+    for (int i = 0; i < assets; ++i)
+        logStartPrices[i] = log(lastPrices[i]);
+    QVector<double> means(columns * assets);
+    QVector<double> deviations(columns * assets);
+    QVector<bool> stepped(columns);
+    for (int h = 0; h < columns; ++h)
+    {
+        const double elapsed = sorted[h] - (h > 0 ? sorted[h - 1] : 0);
+        stepped[h] = elapsed > 0.0;
+        for (int i = 0; i < assets; ++i)
+        {
+            means[h * assets + i] = drifts[i] * elapsed;
+            deviations[h * assets + i] = volatilities[i] * sqrt(elapsed);
+        }
+    }
+    QVector<SimulationResult> results(assets);
+    QVector<double *> values(assets);
+    QVector<double *> likelihoods(assets);
+    for (int i = 0; i < assets; ++i)
+    {
+        results[i] = SimulationResult(numSimulations, columns);
+        results[i].setDayOffsets(sorted);
+        values[i] = results[i].data();
+        likelihoods[i] = results[i].likelihoodData();
+    }
+    const int chunk = qMax(pathBatch, (numSimulations / (threadCount() * 4) + pathBatch - 1) / pathBatch * pathBatch);
+    runParallel(numSimulations, [&](int begin, int end) {
+        QVector<double> shocks(pathBatch * stride, 0.0);
+        QVector<double> correlated(pathBatch * stride);
+        QVector<double> logPrices(pathBatch * stride);
+        QVector<double> logLikelihoods(pathBatch);
+        std::vector<RandomStream> streams;
+        for (int n = begin; n < end; n += pathBatch)
+        {
+            const int rows = qMin(pathBatch, end - n);
+            streams.clear();
+            for (int r = 0; r < rows; ++r)
+            {
+                streams.emplace_back(randomSeed, static_cast<quint64>(n + r), generatorBackend);
+                std::copy(logStartPrices.constData(), logStartPrices.constData() + assets, logPrices.data() + r * stride);
+                logLikelihoods[r] = 0.0;
+            }
+            for (int h = 0; h < columns; ++h)
+            {
+                // A horizon of 0 repeats the start prices without a draw.
+                if (stepped[h])
+                {
+                    for (int r = 0; r < rows; ++r)
+                    {
+                        double *z = shocks.data() + r * stride;
+                        streams[r].fillNormals(z, assets);
+                        for (int i = 0; i < assets; ++i)
+                            logLikelihoods[r] -= 0.5 * z[i] * z[i];
+                    }
+                    Simd::multiply(shocks.constData(), rows, stride, paddedTranspose.constData(), stride, true,
+                                   correlated.data());
+                    const double *mean = means.constData() + h * assets;
+                    const double *deviation = deviations.constData() + h * assets;
+                    for (int r = 0; r < rows; ++r)
+                        for (int i = 0; i < assets; ++i)
+                            logPrices[r * stride + i] += mean[i] + deviation[i] * correlated[r * stride + i];
+                }
+                for (int i = 0; i < assets; ++i)
+                {
+                    double *out = values[i] + static_cast<size_t>(h) * numSimulations + n;
+                    for (int r = 0; r < rows; ++r)
+                        out[r] = logPrices[r * stride + i];
+                }
+            }
+            for (int i = 0; i < assets; ++i)
+                std::copy(logLikelihoods.constData(), logLikelihoods.constData() + rows, likelihoods[i] + n);
+        }
+    }, chunk);
+    runParallel(assets, [&](int begin, int end) {
+        for (int i = begin; i < end; ++i)
+            Simd::expInPlace(values[i], static_cast<size_t>(columns) * numSimulations);
+    }, 1);
+    return results;
+}
@@ -0,0 +1,60 @@
+#ifndef BASKETSIMULATOR_H
+#define BASKETSIMULATOR_H
+#include <QObject>
+#include <QVector>
+#include <functional>
+#include "randomstream.h"
+#include "simulationresult.h"
+class QThreadPool;
+// Joint GBM simulation of a basket of assets with correlated daily log
+// returns. Each asset's drift and volatility follow MonteCarlo's
+// close-to-close convention (drift = mean - variance / 2). The correlation
+// matrix of the aligned log returns is factored once by Cholesky. Paths are
+// simulated in batches: every step draws independent normals for the whole
+// batch and correlates them with one blocked matrix product
+// (Simd::multiply) against the factor. Like MonteCarlo, each path has its
+// own random stream, so results do not depend on the thread count.
+class BasketSimulator : public QObject
+{
+    Q_OBJECT
+public:
+    explicit BasketSimulator(QObject *parent = nullptr);
+    // One close series per asset, aligned on their last closes; longer
+    // series are trimmed to the length of the shortest.
+    void setHistoricalPrices(const QVector<QVector<double>> &prices);
+    int assetCount() const { return assets; }
+    double dailyDrift(int asset) const { return drifts[asset]; }
+    double dailyVolatility(int asset) const { return volatilities[asset]; }
+    // Row-major assetCount() x assetCount() matrices. An asset whose returns
+    // are a combination of earlier ones gets a zero pivot in the factor
+    // rather than failing the decomposition.
+    const QVector<double> &correlation() const { return correlations; }
+    const QVector<double> &choleskyFactor() const { return factor; }
+    void setThreadCount(int count);
+    int threadCount() const;
+    void setSeed(quint64 value) { randomSeed = value; }
+    quint64 seed() const { return randomSeed; }
+    void setRandomGenerator(RandomStream::Generator generator) { generatorBackend = generator; }
+    RandomStream::Generator randomGenerator() const { return generatorBackend; }
+    double expectedPrice(int asset, int days) const;
+    // Prices of every asset at the given day offsets, one result per asset,
+    // each reached from the previous offset with one exact draw as in
+    // MonteCarlo::runHorizons. Path n of every result is the same scenario;
+    // its likelihood covers all the normals of that scenario.
+    QVector<SimulationResult> runHorizons(const QVector<int> &horizons, int numSimulations);
+private:
+    int assets;
+    int stride;
+    QVector<double> lastPrices;
+    QVector<double> drifts;
+    QVector<double> volatilities;
+    QVector<double> correlations;
+    QVector<double> factor;
+    QVector<double> paddedTranspose;
+    int threads;
+    quint64 randomSeed;
+    RandomStream::Generator generatorBackend;
+    QThreadPool *pool;
+    void runParallel(int count, const std::function<void(int, int)> &body, int chunk);
+};
+#endif
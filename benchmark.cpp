@@ -0,0 +1,42 @@
+#include "randomstream.h"
+#include "simdkernels.h"
+#include <QElapsedTimer>
+#include <QVector>
+#include <cstdio>
+// Single-thread normal throughput of every RandomStream backend and normal
+// method, filling the same buffer size the path generators use.
+int main()
+{
+    const int bufferSize = 4096;
+    const qint64 targetNs = 200000000;
+    const RandomStream::Generator generators[] = {RandomStream::Philox, RandomStream::Xoshiro256PlusPlus,
+                                                  RandomStream::Pcg64};
+    const RandomStream::NormalMethod methods[] = {RandomStream::BoxMuller, RandomStream::Ziggurat};
+    QVector<double> buffer(bufferSize);
+    printf("Kernels: %s\n", Simd::instructionSetName(Simd::activeInstructionSet()));
+    printf("%-16s %-12s %14s %12s\n", "Generator", "Normals", "normals/s", "checksum");
+    for (RandomStream::Generator generator : generators)
+    {
+        for (RandomStream::NormalMethod method : methods)
+        {
+            RandomStream stream(42, 0, generator, method);
+            double checksum = 0.0;
+            qint64 produced = 0;
+            QElapsedTimer timer;
+            timer.start();
+            while (timer.nsecsElapsed() < targetNs)
+            {
+                for (int repeat = 0; repeat < 16; ++repeat)
+                {
+                    stream.fillNormals(buffer.data(), bufferSize);
+                    checksum += buffer[repeat];
+                }
+                produced += 16 * bufferSize;
+            }
+            double rate = produced / (timer.nsecsElapsed() / 1e9);
+            printf("%-16s %-12s %14.4g %12.4f\n", RandomStream::generatorName(generator),
+                   RandomStream::normalMethodName(method), rate, checksum);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,46 @@
+#include "bootstrap.h"
+#include "simdkernels.h"
+#include <cmath>
+namespace {
+const quint64 bootstrapStreamSalt = 0x426F6F7473747261ULL;
+}
+BlockBootstrap::BlockBootstrap(const QVector<double> &logReturns, Scheme scheme, int blockLength, quint64 seed,
+                               RandomStream::Generator generator, int steps)
+    : returns(logReturns), method(scheme),
+      length(blockLength > 0 ? blockLength : defaultBlockLength(logReturns.size())),
+      streamSeed(seed ^ bootstrapStreamSalt), engine(generator), stepCount(steps)
+{
+}
+int BlockBootstrap::defaultBlockLength(int sampleSize)
+{
+    return qMax(1, static_cast<int>(round(cbrt(static_cast<double>(sampleSize)))));
+}
+double BlockBootstrap::fill(qint64 path, double *increments) const
+{
+    const int size = returns.size();
+    if (size == 0)
+    {
+        for (int i = 0; i < stepCount; ++i)
+            increments[i] = 0.0;
+        return 0.0;
+    }
+    RandomStream stream(streamSeed, path, engine);
+    QVector<int> indices(stepCount);
+    const double logContinue = length > 1 ? log(1.0 - 1.0 / length) : 0.0;
+    int i = 0;
+    while (i < stepCount)
+    {
+        int index = qMin(size - 1, static_cast<int>(stream.nextUniform() * size));
+        int block = length;
+        if (method == Stationary)
+            block = length > 1 ? 1 + static_cast<int>(qMin(1e9, floor(log(stream.nextUniform()) / logContinue))) : 1;
+        for (int end = qMin(stepCount, i + block); i < end; ++i)
+        {
+            indices[i] = index;
+            if (++index == size)
+                index = 0;
+        }
+    }
+    Simd::gather(returns.constData(), indices.constData(), stepCount, increments);
+    return 0.0;
+}
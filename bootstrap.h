@@ -0,0 +1,39 @@
+#ifndef BOOTSTRAP_H
+#define BOOTSTRAP_H
+#include <QVector>
+#include "randomstream.h"
+// Historical block bootstrap: each path's daily log increments are blocks of
+// consecutive historical log returns, wrapping around the end of the sample.
+//  - Stationary (Politis-Romano): every step starts a new block with
+//    probability 1 / blockLength, so block lengths are geometric.
+//  - FixedBlocks: blocks of exactly blockLength returns.
+// Like ShockGenerator every path is a pure function of the seed and its
+// index. Each block takes one uniform for its start (and one for its
+// geometric length); the returns are then fetched for the whole path with
+// Simd::gather from one contiguous array.
+class BlockBootstrap
+{
+public:
+    enum Scheme
+    {
+        Stationary,
+        FixedBlocks
+    };
+    // blockLength 0 picks the cube root of the sample size.
+    BlockBootstrap(const QVector<double> &logReturns, Scheme scheme, int blockLength, quint64 seed,
+                   RandomStream::Generator generator, int steps);
+    static int defaultBlockLength(int sampleSize);
+    int steps() const { return stepCount; }
+    int blockLength() const { return length; }
+    // Writes the path's log increments; returns 0 as there is no parametric
+    // density to weight against.
+    double fill(qint64 path, double *increments) const;
+private:
+    QVector<double> returns;
+    Scheme method;
+    int length;
+    quint64 streamSeed;
+    RandomStream::Generator engine;
+    int stepCount;
+};
+#endif
@@ -0,0 +1,68 @@
+#include "brownianbridge.h"
+#include <cmath>
+BrownianBridge::BrownianBridge(const QVector<double> &stepLengths)
+    : count(stepLengths.size()), lengths(stepLengths), target(count), left(count), right(count),
+      leftWeight(count), rightWeight(count), deviation(count)
+{
+    if (count == 0)
+        return;
+    // Point i sits at times[i]; left[i] == 0 means anchored at W(0) = 0.
+    QVector<double> times(count + 1, 0.0);
+    for (int i = 0; i < count; ++i)
+        times[i + 1] = times[i] + lengths[i];
+    QVector<bool> filled(count, false);
+    filled[count - 1] = true;
+    target[0] = count - 1;
+    deviation[0] = sqrt(times[count]);
+    int j = 0;
+    for (int i = 1; i < count; ++i)
+    {
+        while (filled[j])
+            ++j;
+        int k = j;
+        while (!filled[k])
+            ++k;
+        int l = j + ((k - 1 - j) >> 1);
+        filled[l] = true;
+        double tLeft = times[j];
+        double tMid = times[l + 1];
+        double tRight = times[k + 1];
+        target[i] = l;
+        left[i] = j;
+        right[i] = k;
+        if (tRight > tLeft)
+        {
+            leftWeight[i] = (tRight - tMid) / (tRight - tLeft);
+            rightWeight[i] = (tMid - tLeft) / (tRight - tLeft);
+            deviation[i] = sqrt((tMid - tLeft) * (tRight - tMid) / (tRight - tLeft));
+        }
+        else
+        {
+            leftWeight[i] = 1.0;
+            rightWeight[i] = 0.0;
+            deviation[i] = 0.0;
+        }
+        j = k + 1;
+        if (j >= count)
+            j = 0;
+    }
+}
+void BrownianBridge::buildIncrements(double *values) const
+{
+    if (count == 0)
+        return;
+    QVector<double> path(count);
+    path[count - 1] = deviation[0] * values[0];
+    for (int i = 1; i < count; ++i)
+    {
+        double anchored = rightWeight[i] * path[right[i]];
+        if (left[i] > 0)
+            anchored += leftWeight[i] * path[left[i] - 1];
+        path[target[i]] = anchored + deviation[i] * values[i];
+    }
+    for (int i = 0; i < count; ++i)
+    {
+        double increment = i == 0 ? path[0] : path[i] - path[i - 1];
+        values[i] = lengths[i] > 0.0 ? increment / sqrt(lengths[i]) : 0.0;
+    }
+}
@@ -0,0 +1,27 @@
+#ifndef BROWNIANBRIDGE_H
+#define BROWNIANBRIDGE_H
+#include <QVector>
+// Brownian bridge construction over a sequence of steps: the first normal
+// fixes the endpoint, the next ones the successive midpoints. Feeding it
+// low-discrepancy normals puts their best dimensions into the coarse shape of
+// the path.
+class BrownianBridge
+{
+public:
+    explicit BrownianBridge(const QVector<double> &stepLengths);
+    int steps() const { return count; }
+    // Turns one standard normal per step into the path's increments, each
+    // divided by the square root of its step length (so again standard
+    // normal), in place.
+    void buildIncrements(double *values) const;
+private:
+    int count;
+    QVector<double> lengths;
+    QVector<int> target;
+    QVector<int> left;
+    QVector<int> right;
+    QVector<double> leftWeight;
+    QVector<double> rightWeight;
+    QVector<double> deviation;
+};
+#endif
@@ -0,0 +1,9 @@
+#ifndef DISTRIBUTIONS_H
+#define DISTRIBUTIONS_H
+namespace Distributions {
+double normalCdf(double x);
+// Acklam's rational approximation refined with one Halley step, accurate to
+// double precision over (0, 1).
+double inverseNormalCdf(double p);
+}
+#endif
@@ -0,0 +1,280 @@
+#include "estimators.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+namespace {
+double priceAt(const SimulationResult &result, int path, int column)
+{
+    double value = result.value(path, column);
+    return result.scale() == SimulationResult::LogPrice ? exp(value) : value;
+}
+// Mean of the per-path values and the variance of the mean, both naive (as if
+// paths were independent) and from group averages.
+template <typename F>
+Estimate groupedMean(int paths, int groupSize, F sample)
+{
+    const int size = qMax(1, groupSize);
+    const int groups = paths / size;
+    double sum = 0.0;
+    double sumSquares = 0.0;
+    double groupSum = 0.0;
+    double groupSumSquares = 0.0;
+    for (int g = 0; g < groups; ++g)
+    {
+        double groupTotal = 0.0;
+        for (int i = g * size; i < (g + 1) * size; ++i)
+        {
+            double x = sample(i);
+            groupTotal += x;
+            sumSquares += x * x;
+        }
+        sum += groupTotal;
+        groupSum += groupTotal / size;
+        groupSumSquares += (groupTotal / size) * (groupTotal / size);
+    }
+    for (int i = groups * size; i < paths; ++i)
+    {
+        double x = sample(i);
+        sum += x;
+        sumSquares += x * x;
+    }
+    Estimate estimate = {0.0, 0.0, 1.0, paths};
+    if (paths == 0)
+        return estimate;
+    estimate.value = sum / paths;
+    double naiveVariance = paths > 1 ? (sumSquares - sum * sum / paths) / (paths - 1) / paths : 0.0;
+    double groupVariance = naiveVariance;
+    if (size > 1 && groups > 1)
+    {
+        double groupMean = groupSum / groups;
+        groupVariance = (groupSumSquares - groups * groupMean * groupMean) / (groups - 1) / groups;
+    }
+    estimate.standardError = sqrt(qMax(0.0, groupVariance));
+    if (groupVariance > 0.0)
+        estimate.varianceReduction = naiveVariance / groupVariance;
+    else if (naiveVariance > 0.0)
+        estimate.varianceReduction = std::numeric_limits<double>::infinity();
+    return estimate;
+}
+// With importance weights the paths are not draws from the model, so the
+// variance plain sampling would have had is estimated from the weighted second
+// moment E[w x^2] - E[w x]^2 instead.
+void compareWithPlainSampling(Estimate &estimate, double weightedSecondMoment)
+{
+    double plainVariance = qMax(0.0, weightedSecondMoment - estimate.value * estimate.value) / qMax<qint64>(1, estimate.samples);
+    double achieved = estimate.standardError * estimate.standardError;
+    if (achieved > 0.0)
+        estimate.varianceReduction = plainVariance / achieved;
+    else if (plainVariance > 0.0)
+        estimate.varianceReduction = std::numeric_limits<double>::infinity();
+}
+template <typename F>
+Estimate weightedMean(const SimulationResult &result, F sample)
+{
+    const int paths = result.pathCount();
+    if (!result.isWeighted())
+        return groupedMean(paths, result.groupSize(), sample);
+    double secondMoment = 0.0;
+    Estimate estimate = groupedMean(paths, result.groupSize(), [&](int path) {
+        double w = result.weight(path);
+        double x = sample(path);
+        secondMoment += w * x * x;
+        return w * x;
+    });
+    if (paths > 0)
+        compareWithPlainSampling(estimate, secondMoment / paths);
+    return estimate;
+}
+// Smallest value whose estimated CDF, mean(w * [x <= value]), reaches p. For
+// unweighted results this is the ordinary order statistic.
+class WeightedColumn
+{
+public:
+    WeightedColumn(const SimulationResult &result, int column) : sorted(result.pathCount())
+    {
+        const int paths = result.pathCount();
+        for (int n = 0; n < paths; ++n)
+            sorted[n] = std::make_pair(priceAt(result, n, column), result.weight(n) / paths);
+        std::sort(sorted.begin(), sorted.end());
+    }
+    double quantile(double p) const
+    {
+        double cumulative = 0.0;
+        for (const std::pair<double, double> &point : sorted)
+        {
+            cumulative += point.second;
+            if (cumulative >= p)
+                return point.first;
+        }
+        return sorted.isEmpty() ? std::numeric_limits<double>::quiet_NaN() : sorted.last().first;
+    }
+private:
+    QVector<std::pair<double, double>> sorted;
+};
+}
+RunningEstimate::RunningEstimate()
+    : samples(0), groups(0), sum(0.0), sumSquares(0.0), groupSum(0.0), groupSumSquares(0.0)
+{
+}
+void RunningEstimate::addGroup(const double *terms, const double *squares, int size)
+{
+    double total = 0.0;
+    for (int i = 0; i < size; ++i)
+    {
+        total += terms[i];
+        sumSquares += squares[i];
+    }
+    sum += total;
+    groupSum += total / size;
+    groupSumSquares += (total / size) * (total / size);
+    samples += size;
+    ++groups;
+}
+Estimate RunningEstimate::estimate() const
+{
+    Estimate estimate = {0.0, 0.0, 1.0, samples};
+    if (samples == 0)
+        return estimate;
+    estimate.value = sum / samples;
+    double plainVariance = qMax(0.0, sumSquares / samples - estimate.value * estimate.value) / samples;
+    double groupVariance = plainVariance;
+    if (groups > 1)
+    {
+        double groupMean = groupSum / groups;
+        groupVariance = qMax(0.0, (groupSumSquares - groups * groupMean * groupMean) / (groups - 1) / groups);
+    }
+    estimate.standardError = sqrt(groupVariance);
+    if (groupVariance > 0.0)
+        estimate.varianceReduction = plainVariance / groupVariance;
+    else if (plainVariance > 0.0)
+        estimate.varianceReduction = std::numeric_limits<double>::infinity();
+    return estimate;
+}
+namespace Estimators {
+Estimate mean(const SimulationResult &result, int column)
+{
+    return weightedMean(result, [&](int path) { return priceAt(result, path, column); });
+}
+// The standard error of a sample quantile is the standard error of the
+// empirical CDF at that point divided by the density there; the density is
+// estimated from a symmetric difference of neighbouring quantiles.
+Estimate quantile(const SimulationResult &result, int column, double probability)
+{
+    const int paths = result.pathCount();
+    Estimate estimate = {0.0, 0.0, 1.0, paths};
+    if (paths == 0)
+        return estimate;
+    double p = qBound(0.0, probability, 1.0);
+    double bandwidth = qMin(0.5 * qMin(p, 1.0 - p), 1.0 / sqrt(static_cast<double>(paths)));
+    double q, spread;
+    if (result.isWeighted())
+    {
+        WeightedColumn weighted(result, column);
+        q = weighted.quantile(p);
+        spread = bandwidth > 0.0 ? weighted.quantile(p + bandwidth) - weighted.quantile(p - bandwidth) : 0.0;
+    }
+    else
+    {
+        q = result.quantile(column, p);
+        spread = bandwidth > 0.0 ? result.quantile(column, p + bandwidth) - result.quantile(column, p - bandwidth) : 0.0;
+    }
+    Estimate cdf = weightedMean(result, [&](int path) { return priceAt(result, path, column) <= q ? 1.0 : 0.0; });
+    estimate.value = q;
+    estimate.varianceReduction = cdf.varianceReduction;
+    if (spread > 0.0)
+        estimate.standardError = cdf.standardError * spread / (2.0 * bandwidth);
+    return estimate;
+}
+Estimate probability(const SimulationResult &result, const PathEvent &event)
+{
+    return weightedMean(result, [&](int path) { return event(result.path(path)) ? 1.0 : 0.0; });
+}
+Estimate probabilityBelow(const SimulationResult &result, int column, double threshold)
+{
+    return weightedMean(result, [&](int path) { return priceAt(result, path, column) <= threshold ? 1.0 : 0.0; });
+}
+Estimate barrierProbability(const SimulationResult &result, double threshold)
+{
+    const double level = result.scale() == SimulationResult::LogPrice ? log(threshold) : threshold;
+    const int days = result.dayCount();
+    return weightedMean(result, [&](int path) {
+        for (int day = 0; day < days; ++day)
+            if (result.value(path, day) <= level)
+                return 1.0;
+        return 0.0;
+    });
+}
+ControlVariateEstimate controlVariateMean(const SimulationResult &result, const PathStatistic &statistic,
+                                          int controlColumn, double controlMean)
+{
+    const int paths = result.pathCount();
+    QVector<double> samples(paths);
+    QVector<double> controls(paths);
+    for (int n = 0; n < paths; ++n)
+    {
+        double w = result.weight(n);
+        samples[n] = w * statistic(result.path(n));
+        controls[n] = w * priceAt(result, n, controlColumn);
+    }
+    return controlVariateMean(samples, controls, controlMean, result.groupSize());
+}
+// Correlated paths are averaged per group first; the regression then runs
+// over the independent group means.
+ControlVariateEstimate controlVariateMean(const QVector<double> &samples, const QVector<double> &controls,
+                                          double controlMean, int groupSize)
+{
+    const int paths = samples.size();
+    const int size = qMax(1, groupSize);
+    const int groups = paths / size;
+    ControlVariateEstimate result = {{0.0, 0.0, 1.0, paths}, 0.0, 0.0};
+    if (groups < 2)
+    {
+        result.estimate = groupedMean(paths, size, [&](int path) { return samples[path]; });
+        return result;
+    }
+    double meanY = 0.0, meanX = 0.0;
+    QVector<double> y(groups), x(groups);
+    for (int g = 0; g < groups; ++g)
+    {
+        for (int i = g * size; i < (g + 1) * size; ++i)
+        {
+            y[g] += samples[i];
+            x[g] += controls[i];
+        }
+        y[g] /= size;
+        x[g] /= size;
+        meanY += y[g];
+        meanX += x[g];
+    }
+    meanY /= groups;
+    meanX /= groups;
+    double sxx = 0.0, sxy = 0.0, syy = 0.0;
+    for (int g = 0; g < groups; ++g)
+    {
+        sxx += (x[g] - meanX) * (x[g] - meanX);
+        sxy += (x[g] - meanX) * (y[g] - meanY);
+        syy += (y[g] - meanY) * (y[g] - meanY);
+    }
+    double beta = sxx > 0.0 ? sxy / sxx : 0.0;
+    double residual = qMax(0.0, syy - beta * sxy) / (groups - 2 > 0 ? groups - 2 : 1);
+    double naive = 0.0;
+    double naiveMean = 0.0;
+    for (double value : samples)
+        naiveMean += value;
+    naiveMean /= paths;
+    for (double value : samples)
+        naive += (value - naiveMean) * (value - naiveMean);
+    naive /= qMax(1, paths - 1) * static_cast<double>(paths);
+    double achieved = residual / groups;
+    result.coefficient = beta;
+    result.correlation = sxx > 0.0 && syy > 0.0 ? sxy / sqrt(sxx * syy) : 0.0;
+    result.estimate.value = meanY - beta * (meanX - controlMean);
+    result.estimate.standardError = sqrt(achieved);
+    if (achieved > 0.0)
+        result.estimate.varianceReduction = naive / achieved;
+    else if (naive > 0.0)
+        result.estimate.varianceReduction = std::numeric_limits<double>::infinity();
+    return result;
+}
+}
@@ -0,0 +1,80 @@
+#ifndef ESTIMATORS_H
+#define ESTIMATORS_H
+#include <QtGlobal>
+#include <functional>
+#include "simulationresult.h"
+// A Monte Carlo estimate with its standard error. varianceReduction is the
+// ratio of the variance plain independent sampling would have had with the
+// same number of paths to the variance actually achieved (1 means no gain).
+struct Estimate
+{
+    double value;
+    double standardError;
+    double varianceReduction;
+    qint64 samples;
+    double lowerBound(double z = 1.96) const { return value - z * standardError; }
+    double upperBound(double z = 1.96) const { return value + z * standardError; }
+};
+struct ControlVariateEstimate
+{
+    Estimate estimate;
+    double coefficient;
+    double correlation;
+};
+// Multilevel estimate of E[statistic(path)]: one entry per level, coarsest
+// first. cost counts simulated steps; plainCost is what single-level sampling
+// at the finest resolution would need for the same standard error, and
+// estimate.varianceReduction is their ratio.
+struct MultilevelEstimate
+{
+    Estimate estimate;
+    QVector<qint64> paths;
+    QVector<double> means;
+    QVector<double> variances;
+    double cost;
+    double plainCost;
+};
+typedef std::function<double(const SimulationView &path)> PathStatistic;
+// Accumulates an estimate over batches. Each call adds one independent
+// sampling group: terms are weight * statistic per path and squares are
+// weight * statistic^2, from which the plain-sampling variance is estimated.
+// Groups must all have the same size.
+class RunningEstimate
+{
+public:
+    RunningEstimate();
+    void addGroup(const double *terms, const double *squares, int size);
+    Estimate estimate() const;
+private:
+    qint64 samples;
+    qint64 groups;
+    double sum;
+    double sumSquares;
+    double groupSum;
+    double groupSumSquares;
+};
+typedef std::function<bool(const SimulationView &path)> PathEvent;
+// Summary statistics over one column of a SimulationResult. Standard errors
+// are computed from the result's sampling groups (antithetic pairs, ...), so
+// correlated paths are never treated as independent. Importance-weighted
+// results are reweighted by their likelihood ratios, and varianceReduction is
+// then measured against plain sampling from the untilted model.
+namespace Estimators {
+Estimate mean(const SimulationResult &result, int column);
+Estimate quantile(const SimulationResult &result, int column, double probability);
+// P(event(path)); with a tilted result this is the importance-sampling
+// estimator of a tail probability.
+Estimate probability(const SimulationResult &result, const PathEvent &event);
+// P(price at column <= threshold) and P(the path touches threshold or below
+// at any stored day).
+Estimate probabilityBelow(const SimulationResult &result, int column, double threshold);
+Estimate barrierProbability(const SimulationResult &result, double threshold);
+// E[statistic(path)] with the price in controlColumn, whose expectation is
+// known exactly (MonteCarlo::expectedPrice), as control variate. The optimal
+// coefficient is fitted from the same paths.
+ControlVariateEstimate controlVariateMean(const SimulationResult &result, const PathStatistic &statistic,
+                                          int controlColumn, double controlMean);
+ControlVariateEstimate controlVariateMean(const QVector<double> &samples, const QVector<double> &controls,
+                                          double controlMean, int groupSize = 1);
+}
+#endif
@@ -0,0 +1,98 @@
+#include "garch.h"
+#include "simdkernels.h"
+#include <QVector>
+#include <QtGlobal>
+#include <cmath>
+namespace {
+const int gridSide = 4;
+const double maxPersistence = 0.9999;
+const double smallestStep = 5e-4;
+const int maxIterations = 200;
+}
+namespace Garch {
+GarchParameters fit(const double *logReturns, int count)
+{
+    GarchParameters parameters = {0.0, 0.0, 0.0, 0.0, 0.0};
+    if (count <= 0)
+        return parameters;
+    double mean = 0.0;
+    for (int i = 0; i < count; ++i)
+        mean += logReturns[i];
+    mean /= count;
+    QVector<double> residuals(count);
+    double variance = 0.0;
+    for (int i = 0; i < count; ++i)
+    {
+        residuals[i] = logReturns[i] - mean;
+        variance += residuals[i] * residuals[i];
+    }
+    variance /= count;
+    parameters.mean = mean;
+    parameters.omega = variance;
+    parameters.initialVariance = variance;
+    if (count < 3 || variance <= 0.0)
+        return parameters;
+    double omega[gridSide * gridSide], alpha[gridSide * gridSide], beta[gridSide * gridSide];
+    double logLikelihoods[gridSide * gridSide];
+    double bestAlpha = 0.05, bestPersistence = 0.95;
+    double bestBeta = bestPersistence - bestAlpha;
+    omega[0] = variance * (1.0 - bestPersistence);
+    Simd::garchLogLikelihoods(residuals.constData(), count, variance, omega, &bestAlpha, &bestBeta, 1,
+                              logLikelihoods);
+    double best = logLikelihoods[0];
+    double step = 0.04;
+    for (int iteration = 0; iteration < maxIterations && step > smallestStep; ++iteration)
+    {
+        int candidates = 0;
+        for (int i = 0; i < gridSide; ++i)
+            for (int j = 0; j < gridSide; ++j)
+            {
+                double a = bestAlpha + (i - 0.5 * (gridSide - 1)) * step;
+                double p = bestPersistence + (j - 0.5 * (gridSide - 1)) * step;
+                if (a < 0.0 || p < a || p > maxPersistence)
+                    continue;
+                alpha[candidates] = a;
+                beta[candidates] = p - a;
+                omega[candidates] = variance * (1.0 - p);
+                ++candidates;
+            }
+        Simd::garchLogLikelihoods(residuals.constData(), count, variance, omega, alpha, beta, candidates,
+                                  logLikelihoods);
+        int winner = -1;
+        for (int c = 0; c < candidates; ++c)
+            if (logLikelihoods[c] > best)
+            {
+                best = logLikelihoods[c];
+                winner = c;
+            }
+        if (winner < 0)
+        {
+            step *= 0.5;
+            continue;
+        }
+        bool outer = fabs(alpha[winner] - bestAlpha) > step || fabs(alpha[winner] + beta[winner] - bestPersistence) > step;
+        bestAlpha = alpha[winner];
+        bestBeta = beta[winner];
+        bestPersistence = bestAlpha + bestBeta;
+        if (!outer)
+            step *= 0.5;
+    }
+    parameters.omega = variance * (1.0 - bestAlpha - bestBeta);
+    parameters.alpha = bestAlpha;
+    parameters.beta = bestBeta;
+    double conditional = variance;
+    for (int i = 0; i < count; ++i)
+        conditional = parameters.omega + bestAlpha * residuals[i] * residuals[i] + bestBeta * conditional;
+    parameters.initialVariance = conditional;
+    return parameters;
+}
+double longRunVariance(const GarchParameters &parameters)
+{
+    double persistence = parameters.alpha + parameters.beta;
+    return persistence < 1.0 ? parameters.omega / (1.0 - persistence) : parameters.initialVariance;
+}
+double expectedGrowth(const GarchParameters &parameters, double days)
+{
+    return exp(parameters.mean * days);
+}
+}
@@ -0,0 +1,26 @@
+#ifndef GARCH_H
+#define GARCH_H
+// GARCH(1,1) in daily units: the log price moves by mean - h / 2 + e with
+// e = sqrt(h) * z, and the next conditional variance is
+// omega + alpha * e^2 + beta * h. initialVariance is the variance of the first
+// simulated day.
+struct GarchParameters
+{
+    double mean;
+    double omega;
+    double alpha;
+    double beta;
+    double initialVariance;
+};
+namespace Garch {
+// Gaussian maximum likelihood with variance targeting (omega is tied to the
+// sample variance), so only alpha and beta are searched. Each iteration of a
+// shrinking pattern search scores a 4 x 4 grid of candidates in one batched
+// likelihood pass (Simd::garchLogLikelihoods). initialVariance is the
+// fitted variance for the day after the last return.
+GarchParameters fit(const double *logReturns, int count);
+double longRunVariance(const GarchParameters &parameters);
+// E[S_t / S_0]; the drift convention keeps this exp(mean * t).
+double expectedGrowth(const GarchParameters &parameters, double days);
+}
+#endif
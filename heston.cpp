@@ -0,0 +1,72 @@
+#include "heston.h"
+#include <QVector>
+#include <QtGlobal>
+#include <cmath>
+namespace Heston {
+HestonParameters fit(const double *logReturns, int count, int maxLag)
+{
+    HestonParameters parameters = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    if (count <= 0)
+        return parameters;
+    double mean = 0.0;
+    for (int i = 0; i < count; ++i)
+        mean += logReturns[i];
+    mean /= count;
+    QVector<double> squares(count);
+    double variance = 0.0;
+    double ewma = 0.0;
+    for (int i = 0; i < count; ++i)
+    {
+        double d = logReturns[i] - mean;
+        squares[i] = d * d;
+        variance += squares[i];
+        ewma = i == 0 ? squares[i] : 0.94 * ewma + 0.06 * squares[i];
+    }
+    variance /= count;
+    parameters.drift = mean;
+    parameters.initialVariance = ewma;
+    parameters.longRunVariance = variance;
+    double squareVariance = 0.0;
+    for (int i = 0; i < count; ++i)
+        squareVariance += (squares[i] - variance) * (squares[i] - variance);
+    squareVariance /= count;
+    if (variance <= 0.0 || squareVariance <= 0.0)
+        return parameters;
+    double sumK = 0.0, sumY = 0.0, sumKK = 0.0, sumKY = 0.0;
+    int points = 0;
+    for (int lag = 1; lag <= maxLag && lag < count; ++lag)
+    {
+        double covariance = 0.0;
+        for (int i = 0; i + lag < count; ++i)
+            covariance += (squares[i] - variance) * (squares[i + lag] - variance);
+        double autocorrelation = covariance / (count * squareVariance);
+        if (autocorrelation <= 0.0)
+            continue;
+        double y = log(autocorrelation);
+        sumK += lag;
+        sumY += y;
+        sumKK += lag * lag;
+        sumKY += lag * y;
+        ++points;
+    }
+    double denominator = points * sumKK - sumK * sumK;
+    if (points < 2 || denominator <= 0.0)
+        return parameters;
+    double slope = (points * sumKY - sumK * sumY) / denominator;
+    parameters.meanReversion = qBound(1e-3, -slope, 1.0);
+    double varianceOfVariance = qMax(0.0, (squareVariance - 2.0 * variance * variance) / 3.0);
+    parameters.volatilityOfVariance = sqrt(2.0 * parameters.meanReversion * varianceOfVariance / variance);
+    if (parameters.volatilityOfVariance <= 0.0)
+        return parameters;
+    double leverage = 0.0;
+    for (int i = 0; i + 1 < count; ++i)
+        leverage += (logReturns[i] - mean) * (squares[i + 1] - variance);
+    leverage /= count - 1;
+    parameters.correlation = qBound(-0.95, leverage / (parameters.volatilityOfVariance * variance), 0.95);
+    return parameters;
+}
+double expectedGrowth(const HestonParameters &parameters, double days)
+{
+    return exp(parameters.drift * days);
+}
+}
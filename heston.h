@@ -0,0 +1,27 @@
+#ifndef HESTON_H
+#define HESTON_H
+// Heston stochastic volatility in daily units: the log price moves by
+// drift - v / 2 plus sqrt(v) times a shock, and the variance v reverts to
+// longRunVariance at rate meanReversion with volatility volatilityOfVariance
+// * sqrt(v). The two shocks have the given correlation.
+struct HestonParameters
+{
+    double drift;
+    double initialVariance;
+    double meanReversion;
+    double longRunVariance;
+    double volatilityOfVariance;
+    double correlation;
+};
+namespace Heston {
+// Method-of-moments fit to daily log returns: the long-run variance is the
+// sample variance, the start variance the RiskMetrics EWMA, mean reversion
+// the decay rate of the squared-return autocorrelations, the volatility of
+// variance follows from the excess kurtosis and the correlation from the
+// covariance of each return with the next squared return (leverage). With
+// no volatility clustering in the history this reduces to GBM.
+HestonParameters fit(const double *logReturns, int count, int maxLag = 20);
+// E[S_t / S_0]; the full-truncation scheme keeps this exact.
+double expectedGrowth(const HestonParameters &parameters, double days);
+}
+#endif
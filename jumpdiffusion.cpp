@@ -0,0 +1,121 @@
+#include "jumpdiffusion.h"
+#include <cmath>
+namespace {
+const quint64 jumpStreamSalt = 0x4A756D7053697A65ULL;
+const int maxJumpsPerStep = 64;
+}
+namespace JumpDiffusion {
+JumpParameters fit(const double *logReturns, int count, double threshold)
+{
+    JumpParameters parameters = {0.0, 0.0, 0.0, 0.0, 0.0};
+    if (count <= 0)
+        return parameters;
+    QVector<bool> isJump(count, false);
+    double mean = 0.0, variance = 0.0;
+    for (int iteration = 0; iteration < 20; ++iteration)
+    {
+        int kept = 0;
+        mean = 0.0;
+        double squares = 0.0;
+        for (int i = 0; i < count; ++i)
+        {
+            if (isJump[i])
+                continue;
+            ++kept;
+            double delta = logReturns[i] - mean;
+            mean += delta / kept;
+            squares += delta * (logReturns[i] - mean);
+        }
+        variance = kept > 0 ? squares / kept : 0.0;
+        double limit = threshold * sqrt(variance);
+        bool changed = false;
+        for (int i = 0; i < count; ++i)
+        {
+            bool jump = limit > 0.0 && fabs(logReturns[i] - mean) > limit;
+            changed = changed || jump != isJump[i];
+            isJump[i] = jump;
+        }
+        if (!changed)
+            break;
+    }
+    int jumps = 0;
+    double jumpMean = 0.0, jumpSquares = 0.0;
+    for (int i = 0; i < count; ++i)
+    {
+        if (!isJump[i])
+            continue;
+        ++jumps;
+        double size = logReturns[i] - mean;
+        double delta = size - jumpMean;
+        jumpMean += delta / jumps;
+        jumpSquares += delta * (size - jumpMean);
+    }
+    parameters.intensity = static_cast<double>(jumps) / count;
+    parameters.meanJump = jumpMean;
+    parameters.jumpVolatility = jumps > 1 ? sqrt(jumpSquares / jumps) : 0.0;
+    parameters.diffusionDrift = mean - variance / 2;
+    parameters.diffusionVolatility = sqrt(variance);
+    return parameters;
+}
+double expectedGrowth(const JumpParameters &parameters, double days)
+{
+    const JumpParameters &p = parameters;
+    double jumpFactor = exp(p.meanJump + 0.5 * p.jumpVolatility * p.jumpVolatility) - 1.0;
+    return exp(days * (p.diffusionDrift + 0.5 * p.diffusionVolatility * p.diffusionVolatility + p.intensity * jumpFactor));
+}
+}
+JumpSampler::JumpSampler(const JumpParameters &parameters, quint64 seed, bool antithetic,
+                         RandomStream::Generator generator, const QVector<double> &stepLengths)
+    : params(parameters), streamSeed(seed ^ jumpStreamSalt), pairs(antithetic), engine(generator),
+      stepCount(stepLengths.size())
+{
+    for (int i = 0; i < stepCount; ++i)
+    {
+        double mean = params.intensity * stepLengths[i];
+        double probability = exp(-mean);
+        double total = 0.0;
+        tableOffsets.append(cumulative.size());
+        for (int k = 0; k < maxJumpsPerStep && total < 1.0 - 1e-15; ++k)
+        {
+            total += probability;
+            cumulative.append(total);
+            logProbabilities.append(log(probability));
+            probability *= mean / (k + 1);
+        }
+    }
+    tableOffsets.append(cumulative.size());
+}
+double JumpSampler::fill(qint64 path, double *jumps, double *workspace) const
+{
+    qint64 base = pairs ? path / 2 : path;
+    RandomStream stream(streamSeed, base, engine);
+    stream.fillUniforms(jumps, stepCount);
+    double logProbability = 0.0;
+    int jumpSteps = 0;
+    for (int i = 0; i < stepCount; ++i)
+    {
+        const int first = tableOffsets[i];
+        const int last = tableOffsets[i + 1] - 1;
+        int k = first;
+        while (k < last && jumps[i] > cumulative[k])
+            ++k;
+        logProbability += logProbabilities[k];
+        jumps[i] = k - first;
+        if (k > first)
+            ++jumpSteps;
+    }
+    if (jumpSteps == 0)
+        return logProbability;
+    double *sizes = workspace;
+    stream.fillNormals(sizes, jumpSteps);
+    int next = 0;
+    for (int i = 0; i < stepCount; ++i)
+    {
+        if (jumps[i] == 0.0)
+            continue;
+        double e = sizes[next++];
+        jumps[i] = jumps[i] * params.meanJump + sqrt(jumps[i]) * params.jumpVolatility * e;
+        logProbability -= 0.5 * e * e;
+    }
+    return logProbability;
+}
@@ -0,0 +1,52 @@
+#ifndef JUMPDIFFUSION_H
+#define JUMPDIFFUSION_H
+#include <QVector>
+#include "randomstream.h"
+// Merton jump-diffusion: each day the log price moves by
+// diffusionDrift + diffusionVolatility * z plus N jumps of size
+// N(meanJump, jumpVolatility^2), with N ~ Poisson(intensity).
+struct JumpParameters
+{
+    double intensity;
+    double meanJump;
+    double jumpVolatility;
+    double diffusionDrift;
+    double diffusionVolatility;
+};
+namespace JumpDiffusion {
+// Iterative threshold fit: returns further than threshold standard
+// deviations from the diffusion mean are classified as jumps, the diffusion
+// moments are re-estimated from the rest, and this repeats until the split is
+// stable. Drift follows MonteCarlo's mean - variance / 2 convention, so a
+// history without jumps gives back the GBM parameters.
+JumpParameters fit(const double *logReturns, int count, double threshold = 3.0);
+// E[S_t / S_0] after the given number of days.
+double expectedGrowth(const JumpParameters &parameters, double days);
+}
+// Draws the jump part of a path's log increments. Like ShockGenerator every
+// path is a pure function of the seed and its index, and antithetic pairs
+// share their jumps. Counts come from a per-step inverse-CDF table over one
+// bulk buffer of uniforms, and jump sizes from one bulk buffer of normals.
+class JumpSampler
+{
+public:
+    JumpSampler(const JumpParameters &parameters, quint64 seed, bool antithetic, RandomStream::Generator generator,
+                const QVector<double> &stepLengths);
+    int steps() const { return stepCount; }
+    // Doubles of caller-owned scratch that fill needs.
+    int workspaceSize() const { return stepCount; }
+    // Writes the summed jump log size per step and returns the log
+    // probability of the jump counts plus -e^2/2 for each jump size shock,
+    // matching the shock likelihood convention.
+    double fill(qint64 path, double *jumps, double *workspace) const;
+private:
+    JumpParameters params;
+    quint64 streamSeed;
+    bool pairs;
+    RandomStream::Generator engine;
+    int stepCount;
+    QVector<int> tableOffsets;
+    QVector<double> cumulative;
+    QVector<double> logProbabilities;
+};
+#endif
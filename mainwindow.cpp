@@ -12,6 +12,7 @@
 #include <QFile>
 #include <QTextStream>
 #include <QMessageBox>
+#include <QStatusBar>
 #include <QDebug>
 #include <algorithm>
 #include <QDateTime>
@@ -42,11 +43,15 @@ void MainWindow::setupUI()
     tickerInput->setPlaceholderText("Enter Stock Ticker");
     periodComboBox = new QComboBox(this);
     periodComboBox->addItems({"1 Month", "6 Months", "1 Year", "2 Years"});
+    volatilityComboBox = new QComboBox(this);
+    for (int e = VolatilityEstimates::CloseToClose; e <= VolatilityEstimates::GarmanKlass; ++e)
+        volatilityComboBox->addItem(VolatilityEstimates::estimatorName(static_cast<VolatilityEstimates::Estimator>(e)));
     mostLikelyCheckBox = new QCheckBox("Most Likely Outcome", this);
     simulateButton = new QPushButton("Simulate", this);
     QHBoxLayout *inputLayout = new QHBoxLayout();
     inputLayout->addWidget(tickerInput);
     inputLayout->addWidget(periodComboBox);
+    inputLayout->addWidget(volatilityComboBox);
     inputLayout->addWidget(mostLikelyCheckBox);
     inputLayout->addWidget(simulateButton);
     customPlot = new QCustomPlot(this);
@@ -57,8 +62,7 @@ void MainWindow::setupUI()
     centralWidget->setLayout(mainLayout);
     setCentralWidget(centralWidget);
     lastTicker = "";
-    storedSimulations.clear();
-    storedLikelihoods.clear();
+    storedSimulations = SimulationResult();
     storedHistoricalDays = 0;
 }
 void MainWindow::setupPlot()
@@ -111,6 +115,7 @@ void MainWindow::onSimulateButtonClicked()
     }
     prices.clear();
     dates.clear();
+    bars.clear();
     QTextStream in(&file);
     QString header = in.readLine();
     while (!in.atEnd()) {
@@ -129,8 +134,10 @@ void MainWindow::onSimulateButtonClicked()
                 qDebug() << "Failed to convert price to double:" << fields.at(4);
                 continue;
             }
+            PriceBar bar = {fields.at(1).toDouble(), fields.at(2).toDouble(), fields.at(3).toDouble(), closePrice};
             dates.append(date);
             prices.append(closePrice);
+            bars.append(bar);
         }
     }
     file.close();
@@ -138,19 +145,22 @@ void MainWindow::onSimulateButtonClicked()
         QMessageBox::warning(this, "Data Error", "No price data available.");
         return;
     }
-    QList<QPair<QDateTime, double>> dataList;
+    QList<QPair<QDateTime, PriceBar>> dataList;
     for (int i = 0; i < dates.size(); ++i) {
-        dataList.append(qMakePair(dates[i], prices[i]));
+        dataList.append(qMakePair(dates[i], bars[i]));
     }
-    std::sort(dataList.begin(), dataList.end(), [](const QPair<QDateTime, double> &a, const QPair<QDateTime, double> &b) {
+    std::sort(dataList.begin(), dataList.end(), [](const QPair<QDateTime, PriceBar> &a, const QPair<QDateTime, PriceBar> &b) {
         return a.first < b.first;
     });
     dates.clear();
     prices.clear();
+    bars.clear();
     for (const auto &pair : dataList) {
         dates.append(pair.first);
-        prices.append(pair.second);
+        prices.append(pair.second.close);
+        bars.append(pair.second);
     }
+    priceIndex = ReturnIndex(prices);
     int historicalDays = 30;
     if (period == "1 Month")
         historicalDays = 30;
@@ -190,29 +200,39 @@ void MainWindow::onSimulateButtonClicked()
     customPlot->graph(0)->setData(timeValues, limitedPrices);
     customPlot->graph(0)->setSelectable(QCP::stSingleData);
     customPlot->graph(0)->setSelectionDecorator(new QCPSelectionDecorator());
-    monteCarlo->setHistoricalPrices(limitedPrices);
+    VolatilityEstimates::Estimator estimator =
+        static_cast<VolatilityEstimates::Estimator>(volatilityComboBox->currentIndex());
+    monteCarlo->setVolatilityEstimator(estimator);
+    if (estimator == VolatilityEstimates::CloseToClose)
+        monteCarlo->setHistoricalWindow(priceIndex, limitedPrices.size());
+    else
+        monteCarlo->setHistoricalBars(bars.mid(bars.size() - limitedPrices.size()));
     int days = historicalDays;
-    int numSimulations = 10;
-    QVector<QVector<double>> simulations;
-    QVector<double> likelihoods;
-    monteCarlo->runSimulations(days, numSimulations, simulations, likelihoods);
-    storedSimulations = simulations;
-    storedLikelihoods = likelihoods;
+    MonteCarlo::StoppingRule rule = {0.005, 50.0, 0, 10};
+    PathStatistic finalPrice = [](const SimulationView &path) { return path.last(); };
+    AdaptiveRun run = monteCarlo->runAdaptive(days, {finalPrice}, rule);
+    storedSimulations = run.sample;
+    const Estimate &expected = run.estimates.first();
+    statusBar()->showMessage(QString("Expected final price %1 +/- %2 (95%) from %3 paths in %4 ms")
+                                 .arg(expected.value, 0, 'f', 2)
+                                 .arg(expected.upperBound() - expected.value, 0, 'f', 2)
+                                 .arg(run.paths)
+                                 .arg(run.elapsedMs, 0, 'f', 0));
     lastTicker = ticker;
     storedHistoricalDays = historicalDays;
     this->dates = limitedDates;
     this->prices = limitedPrices;
-    plotSimulations(simulations, likelihoods, mostLikely);
+    plotSimulations(storedSimulations, mostLikely);
     customPlot->rescaleAxes();
     customPlot->replot();
 }
-void MainWindow::plotSimulations(const QVector<QVector<double>> &simulations, const QVector<double> &likelihoods, bool mostLikely)
+void MainWindow::plotSimulations(const SimulationResult &simulations, bool mostLikely)
 {
     QDateTime lastDate = dates.last();
     if (mostLikely)
     {
-        int maxIndex = std::distance(likelihoods.begin(), std::max_element(likelihoods.begin(), likelihoods.end()));
-        QVector<double> mostLikelySimulation = simulations[maxIndex];
+        int maxIndex = simulations.mostLikelyPath();
+        QVector<double> mostLikelySimulation = simulations.path(maxIndex).toVector();
         QVector<double> simTimeValues;
         for (int i = 0; i < mostLikelySimulation.size(); ++i) {
             QDateTime simDate = lastDate.addDays(i + 1);
@@ -227,17 +247,17 @@ void MainWindow::plotSimulations(const QVector<QVector<double>> &simulations, co
     }
     else
     {
-        for (int n = 0; n < simulations.size(); ++n)
+        for (int n = 0; n < simulations.pathCount(); ++n)
         {
             QVector<double> simTimeValues;
-            QVector<double> simulationPrices = simulations[n];
+            QVector<double> simulationPrices = simulations.path(n).toVector();
             for (int i = 0; i < simulationPrices.size(); ++i) {
                 QDateTime simDate = lastDate.addDays(i + 1);
                 simTimeValues.append(simDate.toSecsSinceEpoch());
             }
             customPlot->addGraph();
             QPen pen;
-            pen.setColor(QColor::fromHsv((n * 255) / simulations.size(), 255, 200));
+            pen.setColor(QColor::fromHsv((n * 255) / simulations.pathCount(), 255, 200));
             customPlot->graph()->setPen(pen);
             customPlot->graph()->setName(QString("Simulation %1").arg(n + 1));
             customPlot->graph()->setData(simTimeValues, simulationPrices);
@@ -245,7 +265,7 @@ void MainWindow::plotSimulations(const QVector<QVector<double>> &simulations, co
             customPlot->graph()->setSelectionDecorator(new QCPSelectionDecorator());
         }
     }
-    customPlot->xAxis->setRange(dates.first().toSecsSinceEpoch(), lastDate.addDays(simulations[0].size()).toSecsSinceEpoch());
+    customPlot->xAxis->setRange(dates.first().toSecsSinceEpoch(), lastDate.addDays(simulations.dayCount()).toSecsSinceEpoch());
     customPlot->yAxis->rescale();
     customPlot->replot();
 }
@@ -267,7 +287,7 @@ void MainWindow::onMostLikelyCheckBoxToggled(bool checked)
         customPlot->graph(0)->setSelectable(QCP::stSingleData);
         customPlot->graph(0)->setSelectionDecorator(new QCPSelectionDecorator());
         bool mostLikely = mostLikelyCheckBox->isChecked();
-        plotSimulations(storedSimulations, storedLikelihoods, mostLikely);
+        plotSimulations(storedSimulations, mostLikely);
         customPlot->rescaleAxes();
         customPlot->replot();
     }
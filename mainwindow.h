@@ -22,20 +22,22 @@ private slots:
 private:
     QLineEdit *tickerInput;
     QComboBox *periodComboBox;
+    QComboBox *volatilityComboBox;
     QCheckBox *mostLikelyCheckBox;
     QPushButton *simulateButton;
     QCustomPlot *customPlot;
     MonteCarlo *monteCarlo;
-    void plotSimulations(const QVector<QVector<double>> &simulations, const QVector<double> &likelihoods, bool mostLikely);
+    void plotSimulations(const SimulationResult &simulations, bool mostLikely);
     void setupUI();
     void setupPlot();
     QVector<double> prices;
     QVector<QDateTime> dates;
+    QVector<PriceBar> bars;
+    ReturnIndex priceIndex;
     QCPGraph *selectedGraph = nullptr;
     QCPItemTracer *graphTracer = nullptr;
     QString lastTicker;
-    QVector<QVector<double>> storedSimulations;
-    QVector<double> storedLikelihoods;
+    SimulationResult storedSimulations;
     int storedHistoricalDays;
 protected:
     void mouseMoveEvent(QMouseEvent *event) override;
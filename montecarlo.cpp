@@ -1,49 +1,1037 @@
 #include "montecarlo.h"
+#include "randomstream.h"
+#include "rangetask.h"
+#include "simdkernels.h"
+#include "tdigest.h"
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QThreadPool>
+#include <algorithm>
 #include <cmath>
-#include <random>
-MonteCarlo::MonteCarlo(QObject *parent) : QObject(parent)
+#include <limits>
+namespace {
+const int pathBlock = 16;
+const int quantileSegment = 4096;
+const int multilevelPilot = 1000;
+const size_t adaptiveBatchValues = 8 * 1024 * 1024;
+const int adaptiveReplicatePaths = 256;
+}
+MonteCarlo::MonteCarlo(QObject *parent)
+    : QObject(parent), windowStart(0), returnCount(0), returnMean(0.0), returnSquares(0.0),
+      estimatesCurrent(true), varianceEstimator(VolatilityEstimates::CloseToClose), drift(0.0), volatility(0.0), threads(0), randomSeed(0),
+      generatorBackend(RandomStream::Philox), normalSampling(RandomStream::BoxMuller), generation(Recursive),
+      pathModel(GeometricBrownian), jumpModel(), hestonModel(), garchModel(), regimeModel(),
+      reversionModel(), levyModel(), resampling(BlockBootstrap::Stationary), resamplingBlock(0), shockShape(Gaussian),
+      tailModel(), antitheticPairs(false), quasiRandom(false), qmcReplicates(16), shockTilt(0.0)
+{
+    regimeModel.regimes = 2;
+    pool = new QThreadPool(this);
+    pool->setMaxThreadCount(threadCount());
+}
+void MonteCarlo::setThreadCount(int count)
+{
+    threads = qMax(0, count);
+    pool->setMaxThreadCount(threadCount());
+}
+int MonteCarlo::threadCount() const
+{
+    return threads > 0 ? threads : qMax(1, QThread::idealThreadCount());
+}
+void MonteCarlo::setSeed(quint64 value)
+{
+    randomSeed = value;
+}
+void MonteCarlo::setQuasiRandom(bool enabled, int replicates)
 {
+    quasiRandom = enabled;
+    qmcReplicates = qMax(1, replicates);
+}
+double MonteCarlo::tiltTowards(double targetPrice, int days) const
+{
+    if (days <= 0 || diffusionVolatility() <= 0.0)
+        return 0.0;
+    return (log(targetPrice / historicalPrices.last()) / days - diffusionDrift()) / diffusionVolatility();
+}
+// sequenced = false leaves out the Sobol points even in quasi-random mode.
+ShockGenerator MonteCarlo::shockGenerator(qint64 numPaths, const QVector<double> &stepLengths, quint64 seed,
+                                          bool tilted, bool sequenced) const
+{
+    ShockGenerator::Settings settings = {seed, antitheticPairs, quasiRandom && sequenced, qmcReplicates,
+                                         tilted ? shockTilt : 0.0, generatorBackend, normalSampling};
+    return ShockGenerator(settings, numPaths, stepLengths);
 }
 void MonteCarlo::setHistoricalPrices(const QVector<double> &prices)
 {
     historicalPrices = prices;
+    windowStart = 0;
     calculateParameters();
+    fitModelParameters();
+}
+void MonteCarlo::setHistoricalWindow(const ReturnIndex &index, int priceCount)
+{
+    historicalPrices = index.prices();
+    windowStart = qBound(0, historicalPrices.size() - priceCount, historicalPrices.size());
+    ReturnIndex::Moments moments = index.lastPrices(historicalPriceCount());
+    returnCount = moments.count;
+    returnMean = moments.mean;
+    returnSquares = moments.variance * moments.count;
+    if (varianceEstimator == VolatilityEstimates::CloseToClose)
+    {
+        estimates = VolatilityEstimates();
+        estimatesCurrent = false;
+        updateParameters();
+    }
+    else
+    {
+        calculateParameters();
+    }
+    fitModelParameters();
+}
+void MonteCarlo::setHistoricalBars(const QVector<PriceBar> &bars)
+{
+    historicalPrices.resize(bars.size());
+    for (int i = 0; i < bars.size(); ++i)
+        historicalPrices[i] = bars[i].close;
+    windowStart = 0;
+    estimates = VolatilityEstimates::fromBars(bars);
+    estimatesCurrent = true;
+    returnCount = estimates.returnCount();
+    returnMean = estimates.meanReturn();
+    returnSquares = estimates.squaredDeviations();
+    updateParameters();
+    fitModelParameters();
+}
+void MonteCarlo::setVolatilityEstimator(VolatilityEstimates::Estimator estimator)
+{
+    varianceEstimator = estimator;
+    if (!estimatesCurrent)
+        calculateParameters();
+    else
+        updateParameters();
 }
+void MonteCarlo::appendPrice(double price)
+{
+    if (historicalPriceCount() > 0)
+        addReturn(log(price / historicalPrices.last()));
+    if (estimatesCurrent)
+        estimates.addClose(price);
+    historicalPrices.append(price);
+    updateParameters();
+}
+// Evicted prices stay in the vector until they make up half of it; the
+// compaction then also refits the moments from scratch so rounding from the
+// Welford removals cannot accumulate.
+void MonteCarlo::slideWindow(double price)
+{
+    if (historicalPriceCount() > 1)
+    {
+        removeReturn(log(historicalPrices[windowStart + 1] / historicalPrices[windowStart]));
+        ++windowStart;
+    }
+    appendPrice(price);
+    if (windowStart > 64 && 2 * windowStart > historicalPrices.size())
+    {
+        historicalPrices.remove(0, windowStart);
+        windowStart = 0;
+        refitReturns();
+        updateParameters();
+    }
+}
+// One fused pass over the window's closes for the close-based estimators.
 void MonteCarlo::calculateParameters()
 {
-    QVector<double> logReturns;
-    for (int i = 1; i < historicalPrices.size(); ++i) {
-        double ret = log(historicalPrices[i] / historicalPrices[i - 1]);
-        logReturns.append(ret);
-    }
-    double sum = 0;
-    for (double val : logReturns) sum += val;
-    double mean = sum / logReturns.size();
-    double variance = 0;
-    for (double val : logReturns) variance += pow(val - mean, 2);
-    variance /= logReturns.size();
-    drift = mean - (variance / 2);
+    estimates = VolatilityEstimates();
+    for (int i = windowStart; i < historicalPrices.size(); ++i)
+        estimates.addClose(historicalPrices[i]);
+    estimatesCurrent = true;
+    returnCount = estimates.returnCount();
+    returnMean = estimates.meanReturn();
+    returnSquares = estimates.squaredDeviations();
+    updateParameters();
+}
+// One Welford pass over the window's log returns.
+void MonteCarlo::refitReturns()
+{
+    returnCount = 0;
+    returnMean = 0.0;
+    returnSquares = 0.0;
+    for (int i = windowStart + 1; i < historicalPrices.size(); ++i)
+        addReturn(log(historicalPrices[i] / historicalPrices[i - 1]));
+}
+void MonteCarlo::addReturn(double value)
+{
+    ++returnCount;
+    double delta = value - returnMean;
+    returnMean += delta / returnCount;
+    returnSquares += delta * (value - returnMean);
+}
+void MonteCarlo::removeReturn(double value)
+{
+    if (returnCount <= 1)
+    {
+        returnCount = 0;
+        returnMean = 0.0;
+        returnSquares = 0.0;
+        return;
+    }
+    --returnCount;
+    double delta = value - returnMean;
+    returnMean -= delta / returnCount;
+    returnSquares = qMax(0.0, returnSquares - delta * (value - returnMean));
+}
+void MonteCarlo::updateParameters()
+{
+    double variance = returnCount > 0 ? returnSquares / returnCount : 0.0;
+    bool rangeBased = varianceEstimator == VolatilityEstimates::Parkinson ||
+                      varianceEstimator == VolatilityEstimates::GarmanKlass;
+    if (varianceEstimator == VolatilityEstimates::Ewma || (rangeBased && estimates.hasRanges()))
+        variance = estimates.variance(varianceEstimator);
+    drift = returnMean - variance / 2;
     volatility = sqrt(variance);
 }
-void MonteCarlo::runSimulations(int days, int numSimulations, QVector<QVector<double>> &simulations, QVector<double> &likelihoods)
+// Closed-form GBM expectation: each step multiplies the price by a lognormal
+// factor with mean exp(drift + volatility^2 / 2), times the mean jump factor
+// under jump-diffusion; t shocks replace the lognormal factor by the
+// tabulated one. The bootstrap figure treats the resampled returns as
+// independent, ignoring the dependence within blocks.
+double MonteCarlo::expectedPrice(int days) const
+{
+    if (hasTabulatedShocks())
+    {
+        double growth = exp(diffusionDrift()) * ShockTable(tailModel).meanExp(diffusionVolatility());
+        const JumpParameters &j = jumpModel;
+        if (pathModel == JumpDiffusion)
+            growth *= exp(j.intensity * (exp(j.meanJump + 0.5 * j.jumpVolatility * j.jumpVolatility) - 1.0));
+        return historicalPrices.last() * pow(growth, days);
+    }
+    if (pathModel == JumpDiffusion)
+        return historicalPrices.last() * JumpDiffusion::expectedGrowth(jumpModel, days);
+    if (pathModel == Heston)
+        return historicalPrices.last() * Heston::expectedGrowth(hestonModel, days);
+    if (pathModel == Garch)
+        return historicalPrices.last() * Garch::expectedGrowth(garchModel, days);
+    if (pathModel == RegimeSwitching)
+        return historicalPrices.last() * RegimeSwitching::expectedGrowth(regimeModel, days);
+    if (pathModel == OrnsteinUhlenbeck)
+        return OrnsteinUhlenbeck::expectedPrice(reversionModel, historicalPrices.last(), days);
+    if (pathModel == VarianceGamma)
+        return historicalPrices.last() * VarianceGamma::expectedGrowth(levyModel, days);
+    if (pathModel == Bootstrap)
+    {
+        double growth = 0.0;
+        for (double r : bootstrapReturns)
+            growth += exp(r);
+        return bootstrapReturns.isEmpty() ? historicalPrices.last()
+                                          : historicalPrices.last() * pow(growth / bootstrapReturns.size(), days);
+    }
+    return historicalPrices.last() * exp(days * (drift + 0.5 * volatility * volatility));
+}
+void MonteCarlo::setModel(Model model)
+{
+    pathModel = model;
+    fitModelParameters();
+}
+void MonteCarlo::fitModelParameters()
+{
+    if (pathModel == JumpDiffusion)
+        fitJumpParameters();
+    else if (pathModel == Heston)
+        fitHestonParameters();
+    else if (pathModel == Garch)
+        fitGarchParameters();
+    else if (pathModel == RegimeSwitching)
+        fitRegimeParameters();
+    else if (pathModel == OrnsteinUhlenbeck)
+        fitOrnsteinUhlenbeckParameters();
+    else if (pathModel == VarianceGamma)
+        fitVarianceGammaParameters();
+    else if (pathModel == Bootstrap)
+        bootstrapReturns = windowLogReturns();
+    if (shockShape != Gaussian)
+        fitStudentTParameters();
+}
+void MonteCarlo::setShockDistribution(ShockDistribution distribution)
+{
+    shockShape = distribution;
+    if (shockShape != Gaussian)
+        fitStudentTParameters();
+}
+void MonteCarlo::fitStudentTParameters()
+{
+    QVector<double> logReturns = windowLogReturns();
+    tailModel = StudentT::fit(logReturns.constData(), logReturns.size(), shockShape == SkewedStudentT);
+}
+void MonteCarlo::setJumpParameters(const JumpParameters &parameters)
+{
+    jumpModel = parameters;
+}
+QVector<double> MonteCarlo::windowLogReturns() const
+{
+    QVector<double> logReturns;
+    logReturns.reserve(historicalPriceCount());
+    for (int i = windowStart + 1; i < historicalPrices.size(); ++i)
+        logReturns.append(log(historicalPrices[i] / historicalPrices[i - 1]));
+    return logReturns;
+}
+void MonteCarlo::fitJumpParameters()
+{
+    QVector<double> logReturns = windowLogReturns();
+    jumpModel = JumpDiffusion::fit(logReturns.constData(), logReturns.size());
+}
+void MonteCarlo::setHestonParameters(const HestonParameters &parameters)
+{
+    hestonModel = parameters;
+}
+void MonteCarlo::fitHestonParameters()
+{
+    QVector<double> logReturns = windowLogReturns();
+    hestonModel = Heston::fit(logReturns.constData(), logReturns.size());
+}
+void MonteCarlo::setBootstrapScheme(BlockBootstrap::Scheme scheme, int blockLength)
+{
+    resampling = scheme;
+    resamplingBlock = qMax(0, blockLength);
+}
+void MonteCarlo::setGarchParameters(const GarchParameters &parameters)
+{
+    garchModel = parameters;
+}
+void MonteCarlo::fitGarchParameters()
+{
+    QVector<double> logReturns = windowLogReturns();
+    garchModel = Garch::fit(logReturns.constData(), logReturns.size());
+}
+void MonteCarlo::setRegimeCount(int count)
+{
+    regimeModel.regimes = qBound(2, count, 3);
+    if (pathModel == RegimeSwitching)
+        fitRegimeParameters();
+}
+void MonteCarlo::setRegimeParameters(const RegimeParameters &parameters)
+{
+    regimeModel = parameters;
+}
+void MonteCarlo::fitRegimeParameters()
+{
+    QVector<double> logReturns = windowLogReturns();
+    regimeModel = RegimeSwitching::fit(logReturns.constData(), logReturns.size(), regimeModel.regimes);
+}
+void MonteCarlo::setOrnsteinUhlenbeckParameters(const OrnsteinUhlenbeckParameters &parameters)
+{
+    reversionModel = parameters;
+}
+void MonteCarlo::fitOrnsteinUhlenbeckParameters()
+{
+    QVector<double> logPrices;
+    logPrices.reserve(historicalPriceCount());
+    for (int i = windowStart; i < historicalPrices.size(); ++i)
+        logPrices.append(log(historicalPrices[i]));
+    reversionModel = OrnsteinUhlenbeck::fit(logPrices.constData(), logPrices.size());
+}
+void MonteCarlo::setVarianceGammaParameters(const VarianceGammaParameters &parameters)
+{
+    levyModel = parameters;
+}
+void MonteCarlo::fitVarianceGammaParameters()
+{
+    QVector<double> logReturns = windowLogReturns();
+    levyModel = VarianceGamma::fit(logReturns.constData(), logReturns.size());
+}
+// Under Heston, GARCH and regime switching these describe the long-run (or
+// start-weighted) log step and the part of its volatility that the
+// (tiltable) price shock drives; under mean reversion, the drift on the
+// first day, and under variance gamma the mean log step.
+double MonteCarlo::diffusionDrift() const
+{
+    if (pathModel == Heston)
+        return hestonModel.drift - 0.5 * hestonModel.longRunVariance;
+    if (pathModel == Garch)
+        return garchModel.mean - 0.5 * Garch::longRunVariance(garchModel);
+    if (pathModel == RegimeSwitching)
+    {
+        double logStep = 0.0;
+        for (int k = 0; k < regimeModel.regimes; ++k)
+            logStep += regimeModel.startProbabilities[k] *
+                       (regimeModel.mean[k] - 0.5 * regimeModel.volatility[k] * regimeModel.volatility[k]);
+        return logStep;
+    }
+    if (pathModel == OrnsteinUhlenbeck)
+        return reversionModel.meanReversion * (reversionModel.longRunMean - log(historicalPrices.last()));
+    if (pathModel == VarianceGamma)
+        return levyModel.mean + VarianceGamma::compensator(levyModel) + levyModel.skew;
+    return pathModel == JumpDiffusion ? jumpModel.diffusionDrift : drift;
+}
+double MonteCarlo::diffusionVolatility() const
 {
-    simulations.clear();
-    likelihoods.clear();
-    std::default_random_engine generator;
-    std::normal_distribution<double> distribution(0.0, 1.0);
-    for (int n = 0; n < numSimulations; ++n)
+    if (pathModel == Heston)
+        return sqrt(hestonModel.longRunVariance * (1.0 - hestonModel.correlation * hestonModel.correlation));
+    if (pathModel == Garch)
+        return sqrt(Garch::longRunVariance(garchModel));
+    if (pathModel == RegimeSwitching)
     {
-        QVector<double> simulation;
-        simulation.append(historicalPrices.last());
-        double logLikelihood = 0.0;
-        for (int i = 1; i < days; ++i)
+        double variance = 0.0;
+        for (int k = 0; k < regimeModel.regimes; ++k)
+            variance += regimeModel.startProbabilities[k] * regimeModel.volatility[k] * regimeModel.volatility[k];
+        return sqrt(variance);
+    }
+    if (pathModel == OrnsteinUhlenbeck)
+        return reversionModel.volatility;
+    if (pathModel == VarianceGamma)
+        return levyModel.volatility;
+    return pathModel == JumpDiffusion ? jumpModel.diffusionVolatility : volatility;
+}
+bool MonteCarlo::hasJumps() const
+{
+    return pathModel == JumpDiffusion && jumpModel.intensity > 0.0;
+}
+bool MonteCarlo::hasTabulatedShocks() const
+{
+    return shockShape != Gaussian && (pathModel == GeometricBrownian || pathModel == JumpDiffusion);
+}
+JumpSampler MonteCarlo::jumpSampler(const QVector<double> &stepLengths, quint64 seed) const
+{
+    JumpParameters parameters = jumpModel;
+    if (!hasJumps())
+        parameters.intensity = 0.0;
+    return JumpSampler(parameters, seed, antitheticPairs, generatorBackend, stepLengths);
+}
+void MonteCarlo::runParallel(int count, const std::function<void(int, int)> &body, int chunk)
+{
+    int workers = threadCount();
+    if (chunk <= 0)
+        chunk = qMax(64, (count / (workers * 4) + pathBlock - 1) & ~(pathBlock - 1));
+    workers = qMin(workers, (count + chunk - 1) / chunk);
+    if (workers <= 1)
+    {
+        if (count > 0)
+            body(0, count);
+        return;
+    }
+    QAtomicInt next(0);
+    for (int t = 0; t < workers; ++t)
+        pool->start(new RangeTask(&next, count, chunk, &body));
+    pool->waitForDone();
+}
+namespace {
+const quint64 varianceStreamSalt = 0x56617269616E6365ULL;
+// Transposes per-path draws (normal shocks or jumps) into a step-major block;
+// samplers that need scratch space are passed it after the densities.
+template <typename Generator, typename... Workspace>
+void fillBlockShocks(const Generator &generator, qint64 firstPath, int lanes, double *pathShocks, double *blockShocks,
+                     double *samplingDensities, Workspace... workspace)
+{
+    const int steps = generator.steps();
+    for (int lane = 0; lane < lanes; ++lane)
+    {
+        samplingDensities[lane] = generator.fill(firstPath + lane, pathShocks, workspace...);
+        for (int i = 0; i < steps; ++i)
+            blockShocks[i * lanes + lane] = pathShocks[i];
+    }
+}
+// The kernels accumulate the nominal log density -z^2/2 of the shocks
+// actually used; subtracting the sampling density gives the likelihood ratio.
+void storeLogWeights(const double *likelihoods, const double *samplingDensities, int lanes, double *logWeights)
+{
+    for (int lane = 0; lane < lanes; ++lane)
+        logWeights[lane] = likelihoods[lane] - samplingDensities[lane];
+}
+}
+// Draws and advances blocks of paths under the model current at
+// construction. One sampler is shared by all workers, each passing its own
+// workspace. Jumps, variance shocks, regimes and gamma clocks come from
+// separately salted streams; their log probabilities are added to the
+// likelihoods after the weights are taken, so importance weights only ever
+// cover the tilted price shocks.
+// Bootstrap increments replace the shocks outright and carry no density. t
+// shocks are transformed normal shocks, so their weights are taken on the
+// normal draws and their likelihoods are the t log densities.
+class MonteCarlo::BlockSampler
+{
+public:
+    BlockSampler(const MonteCarlo &engine, qint64 numPaths, const QVector<double> &stepLengths, quint64 seed,
+                 bool tilted)
+        : shocks(engine.shockGenerator(numPaths, stepLengths, seed, tilted && engine.pathModel != Bootstrap,
+                                       engine.pathModel != Bootstrap)),
+          jumps(engine.jumpSampler(stepLengths, seed)),
+          varianceShocks(engine.shockGenerator(numPaths, stepLengths, seed ^ varianceStreamSalt, false)),
+          bootstrap(engine.bootstrapReturns, engine.resampling, engine.resamplingBlock, seed, engine.generatorBackend,
+                    stepLengths.size()),
+          regimes(engine.regimeModel, seed, engine.antitheticPairs, engine.generatorBackend, stepLengths.size()),
+          clock(engine.levyModel, seed, engine.antitheticPairs, engine.generatorBackend, stepLengths),
+          tails(engine.hasTabulatedShocks() ? ShockTable(engine.tailModel) : ShockTable()),
+          jumping(engine.hasJumps()), model(engine.pathModel), heston(engine.hestonModel), garch(engine.garchModel),
+          drift(engine.diffusionDrift()), volatility(engine.diffusionVolatility()), steps(stepLengths.size()),
+          samplerWorkspace(qMax(jumps.workspaceSize(), clock.workspaceSize()))
+    {
+        levy = engine.levyModel;
+        levyDrift = levy.mean + VarianceGamma::compensator(levy);
+        const OrnsteinUhlenbeckParameters &reversion = engine.reversionModel;
+        reversionDecay = OrnsteinUhlenbeck::decay(reversion, 1.0);
+        reversionOffset = (1.0 - reversionDecay) * reversion.longRunMean;
+        reversionDeviation = OrnsteinUhlenbeck::deviation(reversion, 1.0);
+        const RegimeParameters &r = engine.regimeModel;
+        for (int k = 0; k < 3; ++k)
+        {
+            regimeVolatilities[k] = r.volatility[k];
+            regimeDrifts[k] = r.mean[k] - 0.5 * r.volatility[k] * r.volatility[k];
+        }
+    }
+    // Bootstrap paths resample independently and never use the shocks.
+    qint64 groupSize() const { return model == Bootstrap ? 1 : shocks.groupSize(); }
+    bool isTilted() const { return shocks.isTilted(); }
+    void simulate(qint64 firstPath, int lanes, SimulationResult::Scale scale, double startPrice, double *out,
+                  size_t outStride, double *likelihoods, double *logWeights, QVector<double> &workspace) const
+    {
+        const int blockSize = steps * pathBlock;
+        workspace.resize(steps + 2 * blockSize + 4 * pathBlock + samplerWorkspace);
+        double *pathShocks = workspace.data();
+        double *blockShocks = pathShocks + steps;
+        double *blockExtra = blockShocks + blockSize;
+        double *samplingDensities = blockExtra + blockSize;
+        double *extraLikelihoods = samplingDensities + pathBlock;
+        double *normalLikelihoods = extraLikelihoods + pathBlock;
+        double *tailLikelihoods = normalLikelihoods + pathBlock;
+        double *samplerScratch = tailLikelihoods + pathBlock;
+        const bool logPrices = scale == SimulationResult::LogPrice;
+        if (model == Bootstrap)
+            fillBlockShocks(bootstrap, firstPath, lanes, pathShocks, blockShocks, samplingDensities);
+        else
+            fillBlockShocks(shocks, firstPath, lanes, pathShocks, blockShocks, samplingDensities);
+        if (!tails.isEmpty())
+            tails.apply(blockShocks, steps, lanes, normalLikelihoods, tailLikelihoods);
+        if (model == Heston)
+        {
+            fillBlockShocks(varianceShocks, firstPath, lanes, pathShocks, blockExtra, extraLikelihoods);
+            Simd::hestonPaths(blockShocks, blockExtra, steps, lanes, log(startPrice), heston, logPrices, out,
+                              outStride, likelihoods);
+            for (int lane = 0; lane < lanes; ++lane)
+            {
+                extraLikelihoods[lane] = 0.0;
+                for (int i = 0; i < steps; ++i)
+                    extraLikelihoods[lane] -= 0.5 * blockExtra[i * lanes + lane] * blockExtra[i * lanes + lane];
+            }
+        }
+        else if (model == Garch)
+        {
+            Simd::garchPaths(blockShocks, steps, lanes, log(startPrice), garch, logPrices, out, outStride,
+                             likelihoods);
+        }
+        else if (model == OrnsteinUhlenbeck)
+        {
+            Simd::ouPaths(blockShocks, steps, lanes, log(startPrice), reversionDecay, reversionOffset,
+                          reversionDeviation, logPrices, out, outStride, likelihoods);
+        }
+        else if (model == VarianceGamma)
+        {
+            fillBlockShocks(clock, firstPath, lanes, pathShocks, blockExtra, extraLikelihoods, samplerScratch);
+            Simd::varianceGammaPaths(blockShocks, blockExtra, steps, lanes, log(startPrice), levyDrift, levy.skew,
+                                     levy.volatility, logPrices, out, outStride, likelihoods);
+        }
+        else if (model == RegimeSwitching)
+        {
+            unsigned *packed = reinterpret_cast<unsigned *>(blockExtra);
+            regimes.fillBlock(firstPath, lanes, packed, extraLikelihoods);
+            Simd::regimePaths(blockShocks, packed, steps, lanes, log(startPrice), regimeDrifts, regimeVolatilities,
+                              logPrices, out, outStride, likelihoods);
+        }
+        else
+        {
+            if (jumping)
+                fillBlockShocks(jumps, firstPath, lanes, pathShocks, blockExtra, extraLikelihoods, samplerScratch);
+            const double *blockJumps = jumping ? blockExtra : nullptr;
+            const double stepDrift = model == Bootstrap ? 0.0 : drift;
+            const double stepVolatility = model == Bootstrap ? 1.0 : volatility;
+            if (logPrices)
+                Simd::logPaths(blockShocks, blockJumps, steps, lanes, log(startPrice), stepDrift, stepVolatility, out,
+                               outStride, likelihoods);
+            else
+                Simd::gbmPaths(blockShocks, blockJumps, steps, lanes, startPrice, stepDrift, stepVolatility, out,
+                               outStride, likelihoods);
+        }
+        if (model == Bootstrap)
+            std::fill(likelihoods, likelihoods + lanes, 0.0);
+        if (!tails.isEmpty())
+            std::copy(normalLikelihoods, normalLikelihoods + lanes, likelihoods);
+        if (logWeights)
+            storeLogWeights(likelihoods, samplingDensities, lanes, logWeights);
+        if (!tails.isEmpty())
+            std::copy(tailLikelihoods, tailLikelihoods + lanes, likelihoods);
+        if (jumping || model == Heston || model == RegimeSwitching || model == VarianceGamma)
+            for (int lane = 0; lane < lanes; ++lane)
+                likelihoods[lane] += extraLikelihoods[lane];
+    }
+private:
+    ShockGenerator shocks;
+    JumpSampler jumps;
+    ShockGenerator varianceShocks;
+    BlockBootstrap bootstrap;
+    RegimeSampler regimes;
+    VarianceGammaSampler clock;
+    ShockTable tails;
+    bool jumping;
+    Model model;
+    HestonParameters heston;
+    GarchParameters garch;
+    double drift;
+    double volatility;
+    VarianceGammaParameters levy;
+    double levyDrift;
+    double reversionDecay;
+    double reversionOffset;
+    double reversionDeviation;
+    double regimeDrifts[3];
+    double regimeVolatilities[3];
+    int steps;
+    int samplerWorkspace;
+};
+SimulationResult MonteCarlo::runSimulations(int days, int numSimulations)
+{
+    return simulatePrices(days, numSimulations, randomSeed);
+}
+SimulationResult MonteCarlo::runLogSimulations(int days, int numSimulations)
+{
+    return simulateLogPrices(days, numSimulations, randomSeed);
+}
+SimulationResult MonteCarlo::simulatePrices(int days, int numSimulations, quint64 seed)
+{
+    if (generation == LogCumulative)
+    {
+        SimulationResult simulations = simulatePaths(days, numSimulations, seed, SimulationResult::LogPrice);
+        double *values = simulations.data();
+        runParallel(simulations.dayCount(), [&](int begin, int end) {
+            Simd::expInPlace(values + static_cast<size_t>(begin) * numSimulations,
+                             static_cast<size_t>(end - begin) * numSimulations);
+        });
+        simulations.setScale(SimulationResult::Price);
+        return simulations;
+    }
+    return simulatePaths(days, numSimulations, seed, SimulationResult::Price);
+}
+SimulationResult MonteCarlo::simulateLogPrices(int days, int numSimulations, quint64 seed)
+{
+    return simulatePaths(days, numSimulations, seed, SimulationResult::LogPrice);
+}
+// Blocks of paths are advanced together by the model's path kernel.
+// Every path holds at least day 0, the start price.
+SimulationResult MonteCarlo::simulatePaths(int days, int numSimulations, quint64 seed, SimulationResult::Scale scale)
+{
+    days = qMax(1, days);
+    const int steps = days - 1;
+    const BlockSampler sampler(*this, numSimulations, QVector<double>(steps, 1.0), seed, true);
+    SimulationResult simulations(numSimulations, days);
+    simulations.setScale(scale);
+    simulations.setGroupSize(static_cast<int>(sampler.groupSize()));
+    if (sampler.isTilted())
+        simulations.enableWeights();
+    double *values = simulations.data();
+    double *likelihoods = simulations.likelihoodData();
+    double *logWeights = simulations.logWeightData();
+    const double startPrice = historicalPrices.last();
+    runParallel(numSimulations, [&](int begin, int end) {
+        QVector<double> workspace;
+        for (int n = begin; n < end; n += pathBlock)
+            sampler.simulate(n, qMin(pathBlock, end - n), scale, startPrice, values + n, numSimulations,
+                             likelihoods + n, logWeights ? logWeights + n : nullptr, workspace);
+    });
+    return simulations;
+}
+// Under GBM the log price after d days given the price h days earlier is
+// normal with mean drift * d and variance volatility^2 * d, so each horizon
+// is reached from the previous one with a single exact draw. Jumps over the
+// gap are a Poisson(intensity * d) count of normal sizes, also exact. The
+// Ornstein-Uhlenbeck transition is normal too, with the previous log price
+// scaled by its decay over the gap, and the variance-gamma one is normal
+// given a single gamma time change of shape d / varianceRate.
+SimulationResult MonteCarlo::runHorizons(const QVector<int> &horizons, int numSimulations)
+{
+    QVector<int> sorted = horizons;
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+    while (!sorted.isEmpty() && sorted.first() < 0)
+        sorted.removeFirst();
+    if (pathModel == Heston || pathModel == Garch || pathModel == RegimeSwitching || pathModel == Bootstrap ||
+        hasTabulatedShocks())
+        return simulateDailyHorizons(sorted, numSimulations);
+    // A horizon of 0 is the start price itself and takes no step or draw.
+    const int columns = sorted.size();
+    const int leading = !sorted.isEmpty() && sorted.first() == 0 ? 1 : 0;
+    const int steps = columns - leading;
+    QVector<double> elapsed(steps);
+    QVector<double> decays(steps, 1.0);
+    QVector<double> means(steps);
+    QVector<double> deviations(steps);
+    for (int h = 0; h < steps; ++h)
+    {
+        elapsed[h] = sorted[leading + h] - (leading + h > 0 ? sorted[leading + h - 1] : 0);
+        if (pathModel == OrnsteinUhlenbeck)
+        {
+            decays[h] = OrnsteinUhlenbeck::decay(reversionModel, elapsed[h]);
+            means[h] = (1.0 - decays[h]) * reversionModel.longRunMean;
+            deviations[h] = OrnsteinUhlenbeck::deviation(reversionModel, elapsed[h]);
+            continue;
+        }
+        if (pathModel == VarianceGamma)
+        {
+            means[h] = (levyModel.mean + VarianceGamma::compensator(levyModel)) * elapsed[h];
+            deviations[h] = levyModel.volatility;
+            continue;
+        }
+        means[h] = diffusionDrift() * elapsed[h];
+        deviations[h] = diffusionVolatility() * sqrt(elapsed[h]);
+    }
+    const ShockGenerator generator = shockGenerator(numSimulations, elapsed, randomSeed);
+    const JumpSampler jumpSampler = this->jumpSampler(elapsed, randomSeed);
+    const VarianceGammaSampler clock(levyModel, randomSeed, antitheticPairs, generatorBackend, elapsed);
+    const bool jumping = hasJumps();
+    const bool subordinated = pathModel == VarianceGamma;
+    SimulationResult simulations(numSimulations, columns);
+    simulations.setDayOffsets(sorted);
+    simulations.setGroupSize(static_cast<int>(generator.groupSize()));
+    if (generator.isTilted())
+        simulations.enableWeights();
+    double *values = simulations.data();
+    double *likelihoods = simulations.likelihoodData();
+    double *logWeights = simulations.logWeightData();
+    const double logStartPrice = log(historicalPrices.last());
+    double *stepValues = values + static_cast<size_t>(leading) * numSimulations;
+    if (leading)
+        std::fill(values, stepValues, logStartPrice);
+    runParallel(numSimulations, [&](int begin, int end) {
+        QVector<double> shocks(steps);
+        QVector<double> jumps(steps);
+        QVector<double> times(steps);
+        QVector<double> spreads(steps, 1.0);
+        QVector<double> scratch(qMax(jumpSampler.workspaceSize(), clock.workspaceSize()));
+        for (int n = begin; n < end; ++n)
         {
-            double randomShock = distribution(generator);
-            double price = simulation.last() * exp(drift + volatility * randomShock);
-            simulation.append(price);
-            logLikelihood -= 0.5 * randomShock * randomShock;
+            double samplingDensity = generator.fill(n, shocks.data());
+            double jumpLikelihood = jumping ? jumpSampler.fill(n, jumps.data(), scratch.data()) : 0.0;
+            if (subordinated)
+            {
+                jumpLikelihood = clock.fill(n, times.data(), scratch.data());
+                for (int h = 0; h < steps; ++h)
+                {
+                    jumps[h] = levyModel.skew * times[h];
+                    spreads[h] = sqrt(times[h]);
+                }
+            }
+            double logPrice = logStartPrice;
+            double logLikelihood = 0.0;
+            for (int h = 0; h < steps; ++h)
+            {
+                logPrice = decays[h] * logPrice + (means[h] + deviations[h] * spreads[h] * shocks[h] + jumps[h]);
+                logLikelihood -= 0.5 * shocks[h] * shocks[h];
+                stepValues[static_cast<size_t>(h) * numSimulations + n] = logPrice;
+            }
+            likelihoods[n] = logLikelihood + jumpLikelihood;
+            if (logWeights)
+                logWeights[n] = logLikelihood - samplingDensity;
         }
-        simulations.append(simulation);
-        likelihoods.append(logLikelihood);
+    });
+    Simd::expInPlace(values, static_cast<size_t>(columns) * numSimulations);
+    return simulations;
+}
+// Heston and GARCH variances and sums of t shocks have no exact multi-day
+// transition, and bootstrap blocks span days, so the horizons are read off
+// daily paths a block at a time without keeping the days in between.
+SimulationResult MonteCarlo::simulateDailyHorizons(const QVector<int> &horizons, int numSimulations)
+{
+    const int columns = horizons.size();
+    const int days = columns > 0 ? horizons.last() + 1 : 1;
+    const BlockSampler sampler(*this, numSimulations, QVector<double>(days - 1, 1.0), randomSeed, true);
+    SimulationResult simulations(numSimulations, columns);
+    simulations.setDayOffsets(horizons);
+    simulations.setGroupSize(static_cast<int>(sampler.groupSize()));
+    if (sampler.isTilted())
+        simulations.enableWeights();
+    double *values = simulations.data();
+    double *likelihoods = simulations.likelihoodData();
+    double *logWeights = simulations.logWeightData();
+    const double startPrice = historicalPrices.last();
+    runParallel(numSimulations, [&](int begin, int end) {
+        QVector<double> workspace;
+        QVector<double> blockValues(days * pathBlock);
+        for (int n = begin; n < end; n += pathBlock)
+        {
+            int lanes = qMin(pathBlock, end - n);
+            sampler.simulate(n, lanes, SimulationResult::Price, startPrice, blockValues.data(), lanes, likelihoods + n,
+                             logWeights ? logWeights + n : nullptr, workspace);
+            for (int h = 0; h < columns; ++h)
+                for (int lane = 0; lane < lanes; ++lane)
+                    values[static_cast<size_t>(h) * numSimulations + n + lane] = blockValues[horizons[h] * lanes + lane];
+        }
+    });
+    return simulations;
+}
+// Every level simulates the exact GBM path on its own grid; the coarse
+// partner of a level-l path is the same path observed at every other point,
+// so both terms of Y_l = f(fine) - f(coarse) share their Brownian increments.
+// Each level starts with a pilot batch, then the sample sizes are raised to
+// N_l = eps^-2 sqrt(V_l / C_l) sum_k sqrt(V_k C_k) until none grows. The
+// finest level is the daily path itself, so the estimator has no bias and the
+// whole error budget goes to variance.
+MultilevelEstimate MonteCarlo::runMultilevel(int days, const PathStatistic &statistic, double targetRmse)
+{
+    int finest = 0;
+    while ((1 << finest) < days)
+        ++finest;
+    const int levels = finest + 1;
+    MultilevelEstimate result = {{0.0, 0.0, 1.0, 0}, QVector<qint64>(levels), QVector<double>(levels),
+                                 QVector<double>(levels), 0.0, 0.0};
+    if (days <= 0 || targetRmse <= 0.0)
+        return result;
+    const double startPrice = historicalPrices.last();
+    QVector<int> stepCounts(levels);
+    QVector<double> sums(levels), sumSquares(levels);
+    double fineSum = 0.0, fineSumSquares = 0.0;
+    for (int level = 0; level < levels; ++level)
+    {
+        int spacing = 1 << (finest - level);
+        stepCounts[level] = (days + spacing - 1) / spacing;
+    }
+    auto simulateLevel = [&](int level, int first, int count) {
+        const int spacing = 1 << (finest - level);
+        const int steps = stepCounts[level];
+        QVector<double> differences(count), fineValues(count);
+        runParallel(count, [&](int begin, int end) {
+            QVector<double> shocks(steps);
+            QVector<double> prices(steps + 1);
+            QVector<double> coarse(steps / 2 + 2);
+            for (int n = begin; n < end; ++n)
+            {
+                RandomStream stream(randomSeed, (static_cast<quint64>(level + 1) << 40) | static_cast<quint64>(first + n),
+                                    generatorBackend, normalSampling);
+                stream.fillNormals(shocks.data(), steps);
+                double logPrice = log(startPrice);
+                prices[0] = startPrice;
+                for (int i = 0; i < steps; ++i)
+                {
+                    double dt = qMin(spacing, days - i * spacing);
+                    logPrice += drift * dt + volatility * sqrt(dt) * shocks[i];
+                    prices[i + 1] = exp(logPrice);
+                }
+                double fine = statistic(SimulationView(prices.constData(), steps + 1, 1));
+                fineValues[n] = fine;
+                if (level == 0)
+                {
+                    differences[n] = fine;
+                    continue;
+                }
+                int points = 0;
+                for (int i = 0; i <= steps; i += 2)
+                    coarse[points++] = prices[i];
+                if (steps % 2)
+                    coarse[points++] = prices[steps];
+                differences[n] = fine - statistic(SimulationView(coarse.constData(), points, 1));
+            }
+        });
+        for (int n = 0; n < count; ++n)
+        {
+            sums[level] += differences[n];
+            sumSquares[level] += differences[n] * differences[n];
+        }
+        if (level == finest)
+            for (int n = 0; n < count; ++n)
+            {
+                fineSum += fineValues[n];
+                fineSumSquares += fineValues[n] * fineValues[n];
+            }
+        result.paths[level] += count;
+    };
+    auto levelVariance = [&](int level) {
+        double n = static_cast<double>(result.paths[level]);
+        double mean = sums[level] / n;
+        return n > 1.0 ? qMax(0.0, (sumSquares[level] - n * mean * mean) / (n - 1.0)) : 0.0;
+    };
+    QVector<qint64> targets(levels, multilevelPilot);
+    for (;;)
+    {
+        bool grew = false;
+        for (int level = 0; level < levels; ++level)
+        {
+            qint64 extra = qMin<qint64>(targets[level] - result.paths[level], std::numeric_limits<int>::max());
+            if (extra > 0)
+            {
+                simulateLevel(level, static_cast<int>(result.paths[level]), static_cast<int>(extra));
+                grew = true;
+            }
+        }
+        if (!grew)
+            break;
+        double total = 0.0;
+        for (int level = 0; level < levels; ++level)
+            total += sqrt(levelVariance(level) * stepCounts[level]);
+        for (int level = 0; level < levels; ++level)
+        {
+            double optimal = ceil(sqrt(levelVariance(level) / stepCounts[level]) * total / (targetRmse * targetRmse));
+            targets[level] = qMax(result.paths[level], static_cast<qint64>(qMin(optimal, 1e15)));
+        }
+    }
+    double variance = 0.0;
+    for (int level = 0; level < levels; ++level)
+    {
+        double n = static_cast<double>(result.paths[level]);
+        result.means[level] = sums[level] / n;
+        result.variances[level] = levelVariance(level);
+        result.estimate.value += result.means[level];
+        result.estimate.samples += result.paths[level];
+        result.cost += n * stepCounts[level];
+        variance += result.variances[level] / n;
+    }
+    result.estimate.standardError = sqrt(variance);
+    double fineCount = static_cast<double>(result.paths[finest]);
+    double fineMean = fineSum / fineCount;
+    double fineVariance = fineCount > 1.0 ? qMax(0.0, (fineSumSquares - fineCount * fineMean * fineMean) / (fineCount - 1.0)) : 0.0;
+    if (variance > 0.0)
+        result.plainCost = fineVariance / variance * stepCounts[finest];
+    if (result.cost > 0.0)
+        result.estimate.varianceReduction = result.plainCost / result.cost;
+    return result;
+}
+// Batch sizes are whole sampling groups (antithetic pairs, QMC replicates) and
+// at least a few blocks per worker. After each batch the next one is sized
+// from the paths the widest interval still needs, capped by the remaining
+// time at the measured cost per path and by a fixed memory budget.
+AdaptiveRun MonteCarlo::runAdaptive(int days, const QVector<PathStatistic> &statistics, const StoppingRule &rule)
+{
+    QElapsedTimer timer;
+    timer.start();
+    AdaptiveRun run = {QVector<Estimate>(statistics.size()), 0, 0, 0.0, false, SimulationResult()};
+    if (days <= 0 || (rule.relativeWidth <= 0.0 && rule.timeBudgetMs <= 0.0 && rule.maxPaths <= 0))
+        return run;
+    const qint64 unit = (antitheticPairs ? 2 : 1) * (quasiRandom ? qmcReplicates : 1);
+    auto roundUp = [&](qint64 paths) { return qMax(unit, (paths + unit - 1) / unit * unit); };
+    const qint64 smallest = roundUp(static_cast<qint64>(threadCount()) * pathBlock * 4);
+    const qint64 largest = qMax(smallest, static_cast<qint64>(adaptiveBatchValues / qMax(1, days)) / unit * unit);
+    // QMC replicate means only pool into one estimate when every replicate
+    // has the same size, so quasi-random batches keep a fixed size.
+    qint64 fixedBatch = quasiRandom ? qMax(smallest, unit * adaptiveReplicatePaths) : smallest;
+    if (rule.maxPaths > 0)
+        fixedBatch = qMin(fixedBatch, rule.maxPaths / unit * unit);
+    QVector<RunningEstimate> running(statistics.size());
+    qint64 batch = quasiRandom ? fixedBatch : smallest;
+    for (;;)
+    {
+        if (rule.maxPaths > 0)
+            batch = qMin(batch, rule.maxPaths - run.paths);
+        batch = batch / unit * unit;
+        if (batch <= 0 || (quasiRandom && batch < fixedBatch))
+            break;
+        quint64 batchSeed = randomSeed ^ (0xD1B54A32D192ED03ULL * static_cast<quint64>(run.batches + 1));
+        SimulationResult simulations = simulatePrices(days, static_cast<int>(batch), batchSeed);
+        const int paths = simulations.pathCount();
+        const int group = simulations.groupSize();
+        QVector<QVector<double>> terms(statistics.size(), QVector<double>(paths));
+        QVector<QVector<double>> squares(statistics.size(), QVector<double>(paths));
+        runParallel(paths, [&](int begin, int end) {
+            for (int n = begin; n < end; ++n)
+            {
+                SimulationView path = simulations.path(n);
+                double w = simulations.weight(n);
+                for (int s = 0; s < statistics.size(); ++s)
+                {
+                    double x = statistics[s](path);
+                    terms[s][n] = w * x;
+                    squares[s][n] = w * x * x;
+                }
+            }
+        });
+        for (int s = 0; s < statistics.size(); ++s)
+            for (int g = 0; g + group <= paths; g += group)
+                running[s].addGroup(terms[s].constData() + g, squares[s].constData() + g, group);
+        if (run.batches == 0)
+            run.sample = simulations.firstPaths(rule.keepPaths);
+        run.paths += paths;
+        ++run.batches;
+        double needed = 1.0;
+        bool converged = rule.relativeWidth > 0.0;
+        for (int s = 0; s < statistics.size(); ++s)
+        {
+            run.estimates[s] = running[s].estimate();
+            double halfWidth = run.estimates[s].upperBound() - run.estimates[s].value;
+            double target = rule.relativeWidth * fabs(run.estimates[s].value);
+            if (halfWidth > target)
+            {
+                converged = false;
+                needed = target > 0.0 ? qMax(needed, (halfWidth / target) * (halfWidth / target)) : 4.0;
+            }
+        }
+        run.elapsedMs = timer.nsecsElapsed() / 1e6;
+        if (converged)
+        {
+            run.converged = true;
+            break;
+        }
+        if (quasiRandom)
+            batch = fixedBatch;
+        else
+            batch = qBound(smallest, static_cast<qint64>(run.paths * (qMin(needed, 64.0) - 1.0)), largest);
+        if (rule.timeBudgetMs > 0.0)
+        {
+            double msPerPath = run.elapsedMs / run.paths;
+            double remaining = rule.timeBudgetMs - run.elapsedMs;
+            if (remaining < smallest * msPerPath)
+                break;
+            batch = qMin(batch, static_cast<qint64>(remaining / msPerPath));
+        }
+    }
+    run.elapsedMs = timer.nsecsElapsed() / 1e6;
+    return run;
+}
+QVector<double> MonteCarlo::defaultQuantiles()
+{
+    return QVector<double>{0.05, 0.25, 0.5, 0.75, 0.95};
+}
+// Paths are simulated in fixed segments, each summarised by one t-digest per
+// day of log prices. Segments run a wave at a time and are merged in segment
+// order, so memory stays O(threads x days) and the result does not depend on
+// the thread count. The digests are unweighted, so importance tilting is not
+// applied here. Like simulatePaths, every run keeps at least day 0.
+QuantileSummary MonteCarlo::runQuantiles(int days, qint64 numSimulations, const QVector<double> &probabilities)
+{
+    if (numSimulations <= 0)
+        return QuantileSummary();
+    days = qMax(1, days);
+    QuantileSummary summary(days, probabilities, numSimulations);
+    const double startPrice = historicalPrices.last();
+    const int steps = days - 1;
+    const qint64 segments = (numSimulations + quantileSegment - 1) / quantileSegment;
+    const BlockSampler sampler(*this, numSimulations, QVector<double>(steps, 1.0), randomSeed, false);
+    QVector<TDigest> merged(days);
+    for (qint64 firstSegment = 0; firstSegment < segments; firstSegment += threadCount())
+    {
+        int wave = static_cast<int>(qMin<qint64>(threadCount(), segments - firstSegment));
+        QVector<QVector<TDigest>> partial(wave);
+        runParallel(wave, [&](int begin, int end) {
+            QVector<double> workspace;
+            QVector<double> blockValues(days * pathBlock);
+            QVector<double> likelihoods(pathBlock);
+            for (int w = begin; w < end; ++w)
+            {
+                QVector<TDigest> digests(days);
+                qint64 first = (firstSegment + w) * quantileSegment;
+                qint64 last = qMin(numSimulations, first + quantileSegment);
+                for (qint64 n = first; n < last; n += pathBlock)
+                {
+                    int lanes = static_cast<int>(qMin<qint64>(pathBlock, last - n));
+                    sampler.simulate(n, lanes, SimulationResult::LogPrice, startPrice, blockValues.data(), lanes,
+                                     likelihoods.data(), nullptr, workspace);
+                    for (int day = 0; day < days; ++day)
+                        for (int lane = 0; lane < lanes; ++lane)
+                            digests[day].add(blockValues[day * lanes + lane]);
+                }
+                for (TDigest &digest : digests)
+                    digest.compress();
+                partial[w] = digests;
+            }
+        }, 1);
+        for (int w = 0; w < wave; ++w)
+            for (int day = 0; day < days; ++day)
+                merged[day].merge(partial[w][day]);
     }
+    for (int day = 0; day < days; ++day)
+        for (int level = 0; level < probabilities.size(); ++level)
+            summary.setValue(day, level, exp(merged[day].quantile(probabilities[level])));
+    return summary;
 }
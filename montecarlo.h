@@ -2,17 +2,227 @@
 #define MONTECARLO_H
 #include <QObject>
 #include <QVector>
+#include <functional>
+#include "bootstrap.h"
+#include "estimators.h"
+#include "garch.h"
+#include "heston.h"
+#include "jumpdiffusion.h"
+#include "ornsteinuhlenbeck.h"
+#include "randomstream.h"
+#include "regimeswitching.h"
+#include "returnindex.h"
+#include "shockgenerator.h"
+#include "simulationresult.h"
+#include "studentt.h"
+#include "variancegamma.h"
+#include "volatility.h"
+class QThreadPool;
+// Outcome of an adaptive run: one estimate per requested statistic, how many
+// paths it took, and a few retained paths for display.
+struct AdaptiveRun
+{
+    QVector<Estimate> estimates;
+    qint64 paths;
+    int batches;
+    double elapsedMs;
+    bool converged;
+    SimulationResult sample;
+};
 class MonteCarlo : public QObject
 {
     Q_OBJECT
 public:
+    // An adaptive run stops once every 95% confidence half-width is at most
+    // relativeWidth * |estimate|, or before a batch would overrun
+    // timeBudgetMs, or at maxPaths. Zero disables a condition; a rule with
+    // all three disabled is rejected and simulates nothing.
+    struct StoppingRule
+    {
+        double relativeWidth;
+        double timeBudgetMs;
+        qint64 maxPaths;
+        int keepPaths;
+    };
+    enum PathGeneration
+    {
+        Recursive,
+        LogCumulative
+    };
+    enum Model
+    {
+        GeometricBrownian,
+        JumpDiffusion,
+        Heston,
+        Garch,
+        Bootstrap,
+        RegimeSwitching,
+        OrnsteinUhlenbeck,
+        VarianceGamma
+    };
+    enum ShockDistribution
+    {
+        Gaussian,
+        StudentT,
+        SkewedStudentT
+    };
     explicit MonteCarlo(QObject *parent = nullptr);
     void setHistoricalPrices(const QVector<double> &prices);
-    void runSimulations(int days, int numSimulations, QVector<QVector<double>> &simulations, QVector<double> &likelihoods);
+    // Fits to the last priceCount prices of the index in O(1); the price
+    // vector is shared with the index rather than copied.
+    void setHistoricalWindow(const ReturnIndex &index, int priceCount);
+    // Daily OHLC bars; one fused pass fits every volatility estimator.
+    void setHistoricalBars(const QVector<PriceBar> &bars);
+    // Variance estimator behind the simulated volatility. Range estimators
+    // need bars and fall back to close-to-close without them; incremental
+    // updates keep close-to-close and EWMA current but not the ranges.
+    void setVolatilityEstimator(VolatilityEstimates::Estimator estimator);
+    VolatilityEstimates::Estimator volatilityEstimator() const { return varianceEstimator; }
+    const VolatilityEstimates &volatilityEstimates() const { return estimates; }
+    // Incremental updates: appendPrice grows the window by one close and
+    // slideWindow also evicts the oldest one, both updating drift and
+    // volatility in O(1) (amortised) from running log-return moments.
+    void appendPrice(double price);
+    void slideWindow(double price);
+    int historicalPriceCount() const { return historicalPrices.size() - windowStart; }
+    double dailyDrift() const { return drift; }
+    double dailyVolatility() const { return volatility; }
+    void setThreadCount(int count);
+    int threadCount() const;
+    void setSeed(quint64 value);
+    quint64 seed() const { return randomSeed; }
+    void setRandomGenerator(RandomStream::Generator generator) { generatorBackend = generator; }
+    RandomStream::Generator randomGenerator() const { return generatorBackend; }
+    void setNormalMethod(RandomStream::NormalMethod method) { normalSampling = method; }
+    RandomStream::NormalMethod normalMethod() const { return normalSampling; }
+    // Path model. JumpDiffusion, Heston, Garch, RegimeSwitching,
+    // OrnsteinUhlenbeck and VarianceGamma refit their parameters, and
+    // Bootstrap takes a copy of the window's log returns, whenever the
+    // history is replaced (not on appendPrice / slideWindow); runMultilevel
+    // always simulates GBM with normal shocks.
+    void setModel(Model model);
+    Model model() const { return pathModel; }
+    void setJumpParameters(const JumpParameters &parameters);
+    const JumpParameters &jumpParameters() const { return jumpModel; }
+    void fitJumpParameters();
+    void setHestonParameters(const HestonParameters &parameters);
+    const HestonParameters &hestonParameters() const { return hestonModel; }
+    void fitHestonParameters();
+    void setGarchParameters(const GarchParameters &parameters);
+    const GarchParameters &garchParameters() const { return garchModel; }
+    void fitGarchParameters();
+    // Number of regimes (2 or 3) fitted under RegimeSwitching.
+    void setRegimeCount(int count);
+    int regimeCount() const { return regimeModel.regimes; }
+    void setRegimeParameters(const RegimeParameters &parameters);
+    const RegimeParameters &regimeParameters() const { return regimeModel; }
+    void fitRegimeParameters();
+    // Mean reversion of the log price, fitted to the window's log prices.
+    void setOrnsteinUhlenbeckParameters(const OrnsteinUhlenbeckParameters &parameters);
+    const OrnsteinUhlenbeckParameters &ornsteinUhlenbeckParameters() const { return reversionModel; }
+    void fitOrnsteinUhlenbeckParameters();
+    void setVarianceGammaParameters(const VarianceGammaParameters &parameters);
+    const VarianceGammaParameters &varianceGammaParameters() const { return levyModel; }
+    void fitVarianceGammaParameters();
+    // Shocks of GBM and jump-diffusion paths. The t variants are refitted
+    // with the model and map every normal shock through a tabulated inverse
+    // CDF, so antithetic, quasi-random and tilted sampling carry over, and
+    // path likelihoods use the t density.
+    void setShockDistribution(ShockDistribution distribution);
+    ShockDistribution shockDistribution() const { return shockShape; }
+    void setStudentTParameters(const StudentTParameters &parameters) { tailModel = parameters; }
+    const StudentTParameters &studentTParameters() const { return tailModel; }
+    void fitStudentTParameters();
+    // Bootstrap paths ignore antithetic, quasi-random and tilt settings.
+    void setBootstrapScheme(BlockBootstrap::Scheme scheme, int blockLength = 0);
+    BlockBootstrap::Scheme bootstrapScheme() const { return resampling; }
+    int bootstrapBlockLength() const { return resamplingBlock; }
+    void setPathGeneration(PathGeneration mode) { generation = mode; }
+    PathGeneration pathGeneration() const { return generation; }
+    void setAntithetic(bool enabled) { antitheticPairs = enabled; }
+    bool antithetic() const { return antitheticPairs; }
+    // Randomised QMC: leading Brownian-bridge dimensions from scrambled Sobol
+    // points, with paths split into independently scrambled replicates.
+    void setQuasiRandom(bool enabled, int replicates = 16);
+    bool quasiRandomEnabled() const { return quasiRandom; }
+    int quasiRandomReplicates() const { return qmcReplicates; }
+    // Importance sampling: shocks are drawn from N(tilt, 1) and each path is
+    // weighted by its likelihood ratio. tiltTowards gives the tilt whose mean
+    // path reaches targetPrice after the given number of days.
+    void setImportanceTilt(double tilt) { shockTilt = tilt; }
+    double importanceTilt() const { return shockTilt; }
+    double tiltTowards(double targetPrice, int days) const;
+    double expectedPrice(int days) const;
+    SimulationResult runSimulations(int days, int numSimulations);
+    SimulationResult runLogSimulations(int days, int numSimulations);
+    SimulationResult runHorizons(const QVector<int> &horizons, int numSimulations);
+    // Multilevel Monte Carlo for a path-dependent statistic of daily prices:
+    // level l monitors the path every 2^(L-l) days, down to daily at level L,
+    // and the paths per level are chosen for the target root-mean-square
+    // error. statistic receives prices including day 0 and is called from
+    // several threads at once.
+    MultilevelEstimate runMultilevel(int days, const PathStatistic &statistic, double targetRmse);
+    // Simulates in batches sized to keep every worker busy, each with its own
+    // seed derived from seed(), until rule is met. Quasi-random batches keep
+    // one size so their replicates stay comparable. statistics receive price
+    // paths including day 0.
+    AdaptiveRun runAdaptive(int days, const QVector<PathStatistic> &statistics, const StoppingRule &rule);
+    QuantileSummary runQuantiles(int days, qint64 numSimulations, const QVector<double> &probabilities = defaultQuantiles());
+    static QVector<double> defaultQuantiles();
 private:
     QVector<double> historicalPrices;
+    int windowStart;
+    int returnCount;
+    double returnMean;
+    double returnSquares;
+    VolatilityEstimates estimates;
+    // False once a close-to-close window skipped the estimator pass; the
+    // estimates are then refitted before any estimator needs them.
+    bool estimatesCurrent;
+    VolatilityEstimates::Estimator varianceEstimator;
     double drift;
     double volatility;
+    int threads;
+    quint64 randomSeed;
+    RandomStream::Generator generatorBackend;
+    RandomStream::NormalMethod normalSampling;
+    PathGeneration generation;
+    Model pathModel;
+    JumpParameters jumpModel;
+    HestonParameters hestonModel;
+    GarchParameters garchModel;
+    RegimeParameters regimeModel;
+    OrnsteinUhlenbeckParameters reversionModel;
+    VarianceGammaParameters levyModel;
+    QVector<double> bootstrapReturns;
+    BlockBootstrap::Scheme resampling;
+    int resamplingBlock;
+    ShockDistribution shockShape;
+    StudentTParameters tailModel;
+    bool antitheticPairs;
+    bool quasiRandom;
+    int qmcReplicates;
+    double shockTilt;
+    QThreadPool *pool;
+    class BlockSampler;
     void calculateParameters();
+    void fitModelParameters();
+    QVector<double> windowLogReturns() const;
+    void refitReturns();
+    void addReturn(double value);
+    void removeReturn(double value);
+    void updateParameters();
+    void runParallel(int count, const std::function<void(int, int)> &body, int chunk = 0);
+    SimulationResult simulatePrices(int days, int numSimulations, quint64 seed);
+    SimulationResult simulateLogPrices(int days, int numSimulations, quint64 seed);
+    SimulationResult simulatePaths(int days, int numSimulations, quint64 seed, SimulationResult::Scale scale);
+    SimulationResult simulateDailyHorizons(const QVector<int> &horizons, int numSimulations);
+    double diffusionDrift() const;
+    double diffusionVolatility() const;
+    bool hasJumps() const;
+    bool hasTabulatedShocks() const;
+    JumpSampler jumpSampler(const QVector<double> &stepLengths, quint64 seed) const;
+    ShockGenerator shockGenerator(qint64 numPaths, const QVector<double> &stepLengths, quint64 seed,
+                                  bool tilted = true, bool sequenced = true) const;
 };
 #endif
@@ -0,0 +1,63 @@
+#include "ornsteinuhlenbeck.h"
+#include <QtGlobal>
+#include <cmath>
+namespace {
+const double minimumDecay = 1e-6;
+const double maximumDecay = 1.0 - 1e-4;
+}
+namespace OrnsteinUhlenbeck {
+OrnsteinUhlenbeckParameters fit(const double *logPrices, int count)
+{
+    OrnsteinUhlenbeckParameters parameters = {0.0, count > 0 ? logPrices[count - 1] : 0.0, 0.0};
+    const int pairs = count - 1;
+    if (pairs < 2)
+        return parameters;
+    double meanX = 0.0, meanY = 0.0;
+    for (int t = 0; t < pairs; ++t)
+    {
+        meanX += logPrices[t];
+        meanY += logPrices[t + 1];
+    }
+    meanX /= pairs;
+    meanY /= pairs;
+    double covariance = 0.0, variance = 0.0;
+    for (int t = 0; t < pairs; ++t)
+    {
+        covariance += (logPrices[t] - meanX) * (logPrices[t + 1] - meanY);
+        variance += (logPrices[t] - meanX) * (logPrices[t] - meanX);
+    }
+    if (variance <= 0.0)
+        return parameters;
+    const double b = qBound(minimumDecay, covariance / variance, maximumDecay);
+    const double a = meanY - b * meanX;
+    double residuals = 0.0;
+    for (int t = 0; t < pairs; ++t)
+    {
+        double e = logPrices[t + 1] - a - b * logPrices[t];
+        residuals += e * e;
+    }
+    residuals /= pairs;
+    parameters.meanReversion = -log(b);
+    parameters.longRunMean = a / (1.0 - b);
+    parameters.volatility = sqrt(residuals * 2.0 * parameters.meanReversion / (1.0 - b * b));
+    return parameters;
+}
+double decay(const OrnsteinUhlenbeckParameters &parameters, double elapsed)
+{
+    return exp(-parameters.meanReversion * elapsed);
+}
+double deviation(const OrnsteinUhlenbeckParameters &parameters, double elapsed)
+{
+    const double k = parameters.meanReversion;
+    if (k <= 0.0)
+        return parameters.volatility * sqrt(elapsed);
+    return parameters.volatility * sqrt(-expm1(-2.0 * k * elapsed) / (2.0 * k));
+}
+double expectedPrice(const OrnsteinUhlenbeckParameters &parameters, double startPrice, double days)
+{
+    const double d = decay(parameters, days);
+    const double s = deviation(parameters, days);
+    const double mean = parameters.longRunMean + d * (log(startPrice) - parameters.longRunMean);
+    return exp(mean + 0.5 * s * s);
+}
+}
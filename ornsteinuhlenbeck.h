@@ -0,0 +1,25 @@
+#ifndef ORNSTEINUHLENBECK_H
+#define ORNSTEINUHLENBECK_H
+// Ornstein-Uhlenbeck process on the log price x in daily units:
+// dx = meanReversion * (longRunMean - x) dt + volatility dW. Over any gap
+// the transition is normal, so steps of any length are exact.
+struct OrnsteinUhlenbeckParameters
+{
+    double meanReversion;
+    double longRunMean;
+    double volatility;
+};
+namespace OrnsteinUhlenbeck {
+// Exact maximum likelihood on a window of daily log prices: the AR(1)
+// regression of each log price on the previous one. A window without mean
+// reversion is clamped to a half-life of about 7000 days, which behaves like a
+// random walk with the sample drift.
+OrnsteinUhlenbeckParameters fit(const double *logPrices, int count);
+// Over `elapsed` days x moves to longRunMean + decay * (x - longRunMean) plus
+// deviation times a standard normal shock.
+double decay(const OrnsteinUhlenbeckParameters &parameters, double elapsed);
+double deviation(const OrnsteinUhlenbeckParameters &parameters, double elapsed);
+// E[S_t] from the lognormal transition.
+double expectedPrice(const OrnsteinUhlenbeckParameters &parameters, double startPrice, double days);
+}
+#endif
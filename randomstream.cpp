@@ -0,0 +1,292 @@
+#include "randomstream.h"
+#include "simdkernels.h"
+#include <cmath>
+namespace {
+const quint32 philoxM0 = 0xD2511F53u;
+const quint32 philoxM1 = 0xCD9E8D57u;
+const quint32 philoxW0 = 0x9E3779B9u;
+const quint32 philoxW1 = 0xBB67AE85u;
+const double twoPi = 6.283185307179586476925286766559;
+const quint64 pcgMultiplierHi = 2549297995355413924ULL;
+const quint64 pcgMultiplierLo = 4865540595714422341ULL;
+const int zigguratLayers = 128;
+const double zigguratEdge = 3.442619855899;
+const double zigguratArea = 9.91256303526217e-3;
+inline void mulHiLo(quint32 a, quint32 b, quint32 &hi, quint32 &lo)
+{
+    quint64 product = static_cast<quint64>(a) * b;
+    hi = static_cast<quint32>(product >> 32);
+    lo = static_cast<quint32>(product);
+}
+inline void mulHiLo64(quint64 a, quint64 b, quint64 &hi, quint64 &lo)
+{
+#ifdef __SIZEOF_INT128__
+    unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+    hi = static_cast<quint64>(product >> 64);
+    lo = static_cast<quint64>(product);
+#else
+    quint64 aLo = a & 0xFFFFFFFFu, aHi = a >> 32, bLo = b & 0xFFFFFFFFu, bHi = b >> 32;
+    quint64 low = aLo * bLo;
+    quint64 middle = aHi * bLo + (low >> 32);
+    quint64 cross = aLo * bHi + (middle & 0xFFFFFFFFu);
+    hi = aHi * bHi + (middle >> 32) + (cross >> 32);
+    lo = (cross << 32) | (low & 0xFFFFFFFFu);
+#endif
+}
+inline quint64 rotl(quint64 x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+quint64 splitMix64(quint64 &x)
+{
+    quint64 z = (x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+inline double toUniform(quint64 bits)
+{
+    // 53 random bits centred in their cell, so the result lies in (0, 1).
+    return ((bits >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+// Layer edges x[0] > x[1] = r > ... > x[128] = 0 of the 128-layer ziggurat
+// (Marsaglia & Tsang, in Doornik's formulation) and the ratios x[i+1] / x[i]
+// below which a point of layer i lies wholly inside the curve.
+struct ZigguratTables
+{
+    double edge[zigguratLayers + 1];
+    double ratio[zigguratLayers];
+    ZigguratTables()
+    {
+        double f = exp(-0.5 * zigguratEdge * zigguratEdge);
+        edge[0] = zigguratArea / f;
+        edge[1] = zigguratEdge;
+        edge[zigguratLayers] = 0.0;
+        for (int i = 2; i < zigguratLayers; ++i)
+        {
+            edge[i] = sqrt(-2.0 * log(zigguratArea / edge[i - 1] + f));
+            f = exp(-0.5 * edge[i] * edge[i]);
+        }
+        for (int i = 0; i < zigguratLayers; ++i)
+            ratio[i] = edge[i + 1] / edge[i];
+    }
+};
+const ZigguratTables &zigguratTables()
+{
+    static const ZigguratTables tables;
+    return tables;
+}
+}
+RandomStream::RandomStream(quint64 seed, quint64 stream, Generator generator, NormalMethod normals)
+    : engine(generator), normalMethod(normals), available(0)
+{
+    key[0] = static_cast<quint32>(seed);
+    key[1] = static_cast<quint32>(seed >> 32);
+    counter[0] = 0;
+    counter[1] = 0;
+    counter[2] = static_cast<quint32>(stream);
+    counter[3] = static_cast<quint32>(stream >> 32);
+    if (engine == Xoshiro256PlusPlus)
+    {
+        quint64 streamMix = stream;
+        quint64 mix = seed ^ splitMix64(streamMix);
+        for (int i = 0; i < 4; ++i)
+            state[i] = splitMix64(mix);
+    }
+    else if (engine == Pcg64)
+    {
+        quint64 seedMix = seed;
+        state[2] = stream >> 63;
+        state[3] = (stream << 1) | 1u;
+        state[0] = 0;
+        state[1] = 0;
+        nextPcg();
+        quint64 low = state[1] + splitMix64(seedMix);
+        state[0] += splitMix64(seedMix) + (low < state[1] ? 1 : 0);
+        state[1] = low;
+        nextPcg();
+    }
+    else
+    {
+        state[0] = state[1] = state[2] = state[3] = 0;
+    }
+}
+const char *RandomStream::generatorName(Generator generator)
+{
+    switch (generator)
+    {
+    case Xoshiro256PlusPlus:
+        return "xoshiro256++";
+    case Pcg64:
+        return "PCG64";
+    default:
+        return "Philox4x32-10";
+    }
+}
+const char *RandomStream::normalMethodName(NormalMethod method)
+{
+    return method == Ziggurat ? "Ziggurat" : "Box-Muller";
+}
+void RandomStream::generateBlock()
+{
+    quint32 c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+    quint32 k0 = key[0], k1 = key[1];
+    for (int round = 0; round < 10; ++round)
+    {
+        quint32 hi0, lo0, hi1, lo1;
+        mulHiLo(philoxM0, c0, hi0, lo0);
+        mulHiLo(philoxM1, c2, hi1, lo1);
+        c0 = hi1 ^ c1 ^ k0;
+        c1 = lo1;
+        c2 = hi0 ^ c3 ^ k1;
+        c3 = lo0;
+        k0 += philoxW0;
+        k1 += philoxW1;
+    }
+    output[0] = c0;
+    output[1] = c1;
+    output[2] = c2;
+    output[3] = c3;
+    available = 2;
+    if (++counter[0] == 0)
+        ++counter[1];
+}
+inline quint64 RandomStream::nextPhilox()
+{
+    if (available == 0)
+        generateBlock();
+    int index = 2 - available;
+    --available;
+    return (static_cast<quint64>(output[2 * index + 1]) << 32) | output[2 * index];
+}
+inline quint64 RandomStream::nextXoshiro()
+{
+    quint64 result = rotl(state[0] + state[3], 23) + state[0];
+    quint64 t = state[1] << 17;
+    state[2] ^= state[0];
+    state[3] ^= state[1];
+    state[1] ^= state[2];
+    state[0] ^= state[3];
+    state[2] ^= t;
+    state[3] = rotl(state[3], 45);
+    return result;
+}
+// state[0..1] is the 128-bit LCG state (high word first) and state[2..3] the
+// odd increment.
+inline quint64 RandomStream::nextPcg()
+{
+    quint64 hi, lo;
+    mulHiLo64(state[1], pcgMultiplierLo, hi, lo);
+    hi += state[0] * pcgMultiplierLo + state[1] * pcgMultiplierHi;
+    quint64 low = lo + state[3];
+    state[0] = hi + state[2] + (low < lo ? 1 : 0);
+    state[1] = low;
+    quint64 folded = state[0] ^ state[1];
+    int rotation = static_cast<int>(state[0] >> 58);
+    return (folded >> rotation) | (folded << ((64 - rotation) & 63));
+}
+quint64 RandomStream::next()
+{
+    switch (engine)
+    {
+    case Xoshiro256PlusPlus:
+        return nextXoshiro();
+    case Pcg64:
+        return nextPcg();
+    default:
+        return nextPhilox();
+    }
+}
+double RandomStream::nextUniform()
+{
+    return toUniform(next());
+}
+template <typename Next>
+void RandomStream::fillUniformsWith(double *out, int count, Next next)
+{
+    for (int i = 0; i < count; ++i)
+        out[i] = toUniform(next());
+}
+void RandomStream::fillUniforms(double *out, int count)
+{
+    switch (engine)
+    {
+    case Xoshiro256PlusPlus:
+        fillUniformsWith(out, count, [this]() { return nextXoshiro(); });
+        break;
+    case Pcg64:
+        fillUniformsWith(out, count, [this]() { return nextPcg(); });
+        break;
+    default:
+        fillUniformsWith(out, count, [this]() { return nextPhilox(); });
+        break;
+    }
+}
+// One 64-bit draw per attempt: the low 7 bits pick the layer and the top 53
+// give a signed position across it. About 98.8% of draws are accepted by
+// the rectangle test alone; the rest fall back to the exact wedge or tail.
+template <typename Next>
+void RandomStream::fillZigguratWith(double *out, int count, Next next)
+{
+    const ZigguratTables &tables = zigguratTables();
+    for (int n = 0; n < count; ++n)
+    {
+        for (;;)
+        {
+            quint64 bits = next();
+            int layer = static_cast<int>(bits & (zigguratLayers - 1));
+            double u = 2.0 * toUniform(bits) - 1.0;
+            if (fabs(u) < tables.ratio[layer])
+            {
+                out[n] = u * tables.edge[layer];
+                break;
+            }
+            if (layer == 0)
+            {
+                double x, y;
+                do
+                {
+                    x = log(toUniform(next())) / zigguratEdge;
+                    y = log(toUniform(next()));
+                } while (-2.0 * y < x * x);
+                out[n] = u < 0.0 ? x - zigguratEdge : zigguratEdge - x;
+                break;
+            }
+            double x = u * tables.edge[layer];
+            double outer = exp(-0.5 * (tables.edge[layer] * tables.edge[layer] - x * x));
+            double inner = exp(-0.5 * (tables.edge[layer + 1] * tables.edge[layer + 1] - x * x));
+            if (inner + toUniform(next()) * (outer - inner) < 1.0)
+            {
+                out[n] = x;
+                break;
+            }
+        }
+    }
+}
+void RandomStream::fillNormals(double *out, int count)
+{
+    if (normalMethod == Ziggurat)
+    {
+        switch (engine)
+        {
+        case Xoshiro256PlusPlus:
+            fillZigguratWith(out, count, [this]() { return nextXoshiro(); });
+            break;
+        case Pcg64:
+            fillZigguratWith(out, count, [this]() { return nextPcg(); });
+            break;
+        default:
+            fillZigguratWith(out, count, [this]() { return nextPhilox(); });
+            break;
+        }
+        return;
+    }
+    int paired = count & ~1;
+    fillUniforms(out, paired);
+    Simd::boxMuller(out, paired);
+    if (paired < count)
+    {
+        double radius = sqrt(-2.0 * log(nextUniform()));
+        out[paired] = radius * cos(twoPi * nextUniform());
+    }
+}
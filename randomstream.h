@@ -0,0 +1,50 @@
+#ifndef RANDOMSTREAM_H
+#define RANDOMSTREAM_H
+#include <QtGlobal>
+// Per-path random stream. Every backend is keyed by the run seed and a stream
+// id (one per path), so any path can be regenerated independently of how
+// paths were split across threads:
+//  - Philox4x32-10 is counter-based; the stream id is part of the counter.
+//  - xoshiro256++ is seeded by running splitmix64 over seed and stream.
+//  - PCG64 (XSL-RR 128/64) uses the stream id to select its increment.
+// Normals come either from the vectorised Box-Muller kernel or from a
+// 128-layer ziggurat, both filled a buffer at a time.
+class RandomStream
+{
+public:
+    enum Generator
+    {
+        Philox,
+        Xoshiro256PlusPlus,
+        Pcg64
+    };
+    enum NormalMethod
+    {
+        BoxMuller,
+        Ziggurat
+    };
+    RandomStream(quint64 seed, quint64 stream, Generator generator = Philox, NormalMethod normals = BoxMuller);
+    static const char *generatorName(Generator generator);
+    static const char *normalMethodName(NormalMethod method);
+    quint64 next();
+    double nextUniform();
+    void fillUniforms(double *out, int count);
+    void fillNormals(double *out, int count);
+private:
+    Generator engine;
+    NormalMethod normalMethod;
+    quint32 key[2];
+    quint32 counter[4];
+    quint32 output[4];
+    int available;
+    quint64 state[4];
+    void generateBlock();
+    quint64 nextPhilox();
+    quint64 nextXoshiro();
+    quint64 nextPcg();
+    template <typename Next>
+    void fillUniformsWith(double *out, int count, Next next);
+    template <typename Next>
+    void fillZigguratWith(double *out, int count, Next next);
+};
+#endif
@@ -0,0 +1,32 @@
+#ifndef RANGETASK_H
+#define RANGETASK_H
+#include <QAtomicInt>
+#include <QRunnable>
+#include <QtGlobal>
+#include <functional>
+// Pool worker that claims [begin, begin + chunk) ranges of 0 .. count - 1
+// from a shared counter until none are left, so uneven ranges balance out.
+class RangeTask : public QRunnable
+{
+public:
+    RangeTask(QAtomicInt *next, int count, int chunk, const std::function<void(int, int)> *body)
+        : next(next), count(count), chunk(chunk), body(body)
+    {
+    }
+    void run() override
+    {
+        for (;;)
+        {
+            int begin = next->fetchAndAddRelaxed(chunk);
+            if (begin >= count)
+                break;
+            (*body)(begin, qMin(count, begin + chunk));
+        }
+    }
+private:
+    QAtomicInt *next;
+    int count;
+    int chunk;
+    const std::function<void(int, int)> *body;
+};
+#endif
@@ -0,0 +1,222 @@
+#include "regimeswitching.h"
+#include "simdkernels.h"
+#include <QtGlobal>
+#include <algorithm>
+#include <cmath>
+namespace {
+const quint64 regimeStreamSalt = 0x526567696D657321ULL;
+const double tolerance = 1e-9;
+}
+namespace RegimeSwitching {
+RegimeParameters fit(const double *logReturns, int count, int regimes, int maxIterations)
+{
+    const int n = qBound(2, regimes, 3);
+    RegimeParameters p = {n, {0.0, 0.0, 0.0}, {0.0, 0.0, 0.0}, {{0.0}}, {0.0, 0.0, 0.0}};
+    double mean = 0.0;
+    for (int t = 0; t < count; ++t)
+        mean += logReturns[t];
+    mean = count > 0 ? mean / count : 0.0;
+    double variance = 0.0;
+    for (int t = 0; t < count; ++t)
+        variance += (logReturns[t] - mean) * (logReturns[t] - mean);
+    variance = count > 0 ? variance / count : 0.0;
+    const double scales[2][3] = {{0.6, 1.6, 0.0}, {0.5, 1.0, 2.0}};
+    double initial[3];
+    for (int k = 0; k < n; ++k)
+    {
+        p.mean[k] = mean;
+        p.volatility[k] = sqrt(variance) * scales[n - 2][k];
+        initial[k] = 1.0 / n;
+        p.startProbabilities[k] = 1.0 / n;
+        for (int j = 0; j < n; ++j)
+            p.transition[k][j] = k == j ? 0.95 : 0.05 / (n - 1);
+    }
+    if (count < 10 || variance <= 0.0)
+        return p;
+    const double minimumVolatility = 1e-3 * sqrt(variance);
+    QVector<double> densities(n * count), forward(n * count), backward(n * count), scaling(count);
+    double previous = -HUGE_VAL;
+    for (int iteration = 0; iteration < maxIterations; ++iteration)
+    {
+        for (int k = 0; k < n; ++k)
+        {
+            double *row = densities.data() + k * count;
+            double inverse = 1.0 / p.volatility[k];
+            double logScale = log(p.volatility[k]);
+            for (int t = 0; t < count; ++t)
+            {
+                double z = (logReturns[t] - p.mean[k]) * inverse;
+                row[t] = -0.5 * z * z - logScale;
+            }
+        }
+        Simd::expInPlace(densities.data(), densities.size());
+        double logLikelihood = 0.0;
+        for (int t = 0; t < count; ++t)
+        {
+            double total = 0.0;
+            for (int k = 0; k < n; ++k)
+            {
+                double prior = 0.0;
+                if (t == 0)
+                    prior = initial[k];
+                else
+                    for (int j = 0; j < n; ++j)
+                        prior += forward[j * count + t - 1] * p.transition[j][k];
+                forward[k * count + t] = prior * densities[k * count + t];
+                total += forward[k * count + t];
+            }
+            total = qMax(total, 1e-300);
+            scaling[t] = total;
+            for (int k = 0; k < n; ++k)
+                forward[k * count + t] /= total;
+            logLikelihood += log(total);
+        }
+        for (int k = 0; k < n; ++k)
+            backward[k * count + count - 1] = 1.0;
+        for (int t = count - 2; t >= 0; --t)
+            for (int j = 0; j < n; ++j)
+            {
+                double sum = 0.0;
+                for (int k = 0; k < n; ++k)
+                    sum += p.transition[j][k] * densities[k * count + t + 1] * backward[k * count + t + 1];
+                backward[j * count + t] = sum / scaling[t + 1];
+            }
+        double weights[3] = {0.0, 0.0, 0.0}, sums[3] = {0.0, 0.0, 0.0}, leaving[3] = {0.0, 0.0, 0.0};
+        double moves[3][3] = {{0.0}};
+        for (int t = 0; t < count; ++t)
+            for (int k = 0; k < n; ++k)
+            {
+                double gamma = forward[k * count + t] * backward[k * count + t];
+                weights[k] += gamma;
+                sums[k] += gamma * logReturns[t];
+                if (t + 1 < count)
+                {
+                    leaving[k] += gamma;
+                    for (int j = 0; j < n; ++j)
+                        moves[k][j] += forward[k * count + t] * p.transition[k][j] * densities[j * count + t + 1] *
+                                       backward[j * count + t + 1] / scaling[t + 1];
+                }
+            }
+        for (int k = 0; k < n; ++k)
+        {
+            initial[k] = forward[k * count] * backward[k * count];
+            p.mean[k] = weights[k] > 0.0 ? sums[k] / weights[k] : mean;
+            double squares = 0.0;
+            for (int t = 0; t < count; ++t)
+            {
+                double d = logReturns[t] - p.mean[k];
+                squares += forward[k * count + t] * backward[k * count + t] * d * d;
+            }
+            p.volatility[k] = weights[k] > 0.0 ? qMax(minimumVolatility, sqrt(squares / weights[k])) : sqrt(variance);
+            for (int j = 0; j < n; ++j)
+                p.transition[k][j] = leaving[k] > 0.0 ? moves[k][j] / leaving[k] : (k == j ? 1.0 : 0.0);
+        }
+        if (fabs(logLikelihood - previous) <= tolerance * fabs(logLikelihood))
+            break;
+        previous = logLikelihood;
+    }
+    int order[3] = {0, 1, 2};
+    std::sort(order, order + n, [&](int a, int b) { return p.volatility[a] < p.volatility[b]; });
+    RegimeParameters sorted = p;
+    for (int k = 0; k < n; ++k)
+    {
+        sorted.mean[k] = p.mean[order[k]];
+        sorted.volatility[k] = p.volatility[order[k]];
+        sorted.startProbabilities[k] = forward[order[k] * count + count - 1];
+        for (int j = 0; j < n; ++j)
+            sorted.transition[k][j] = p.transition[order[k]][order[j]];
+    }
+    return sorted;
+}
+double expectedGrowth(const RegimeParameters &parameters, int days)
+{
+    const RegimeParameters &p = parameters;
+    double weights[3] = {p.startProbabilities[0], p.startProbabilities[1], p.startProbabilities[2]};
+    for (int day = 0; day < days; ++day)
+    {
+        double next[3] = {0.0, 0.0, 0.0};
+        for (int j = 0; j < p.regimes; ++j)
+            for (int k = 0; k < p.regimes; ++k)
+                next[k] += weights[j] * p.transition[j][k];
+        for (int k = 0; k < p.regimes; ++k)
+            weights[k] = next[k] * exp(p.mean[k]);
+    }
+    double growth = 0.0;
+    for (int k = 0; k < p.regimes; ++k)
+        growth += weights[k];
+    return growth;
+}
+}
+RegimeSampler::RegimeSampler(const RegimeParameters &parameters, quint64 seed, bool antithetic,
+                             RandomStream::Generator generator, int steps)
+    : params(parameters), streamSeed(seed ^ regimeStreamSalt), pairs(antithetic), engine(generator), stepCount(steps)
+{
+    const int n = params.regimes;
+    double total = 0.0;
+    for (int k = 0; k < n; ++k)
+    {
+        double probability = 0.0;
+        for (int j = 0; j < n; ++j)
+            probability += params.startProbabilities[j] * params.transition[j][k];
+        logStart[k] = log(probability);
+        total += probability;
+        startCumulative[k] = total;
+        double leaving = 1.0 - params.transition[k][k];
+        double switched = 0.0;
+        logStay[k] = log(params.transition[k][k]);
+        for (int j = 0; j < n; ++j)
+        {
+            logTransition[k][j] = log(params.transition[k][j]);
+            if (j != k && leaving > 0.0)
+                switched += params.transition[k][j] / leaving;
+            switchCumulative[k][j] = switched;
+        }
+        for (int j = n - 1; j >= 0; --j)
+            if (j != k)
+            {
+                switchCumulative[k][j] = 1.0;
+                break;
+            }
+    }
+}
+// Holding times are geometric, so a path costs one uniform per regime visit
+// (two with three regimes) instead of one per step. The log probability
+// counts the stays and switches the sequence is made of.
+void RegimeSampler::fillBlock(qint64 firstPath, int lanes, unsigned *packed, double *logProbabilities) const
+{
+    std::fill(packed, packed + stepCount, 0u);
+    const int last = params.regimes - 1;
+    for (int lane = 0; lane < lanes; ++lane)
+    {
+        qint64 path = firstPath + lane;
+        RandomStream stream(streamSeed, pairs ? path / 2 : path, engine);
+        double u = stream.nextUniform();
+        int state = 0;
+        while (state < last && u > startCumulative[state])
+            ++state;
+        double logProbability = logStart[state];
+        for (int i = 0; i < stepCount;)
+        {
+            int remaining = stepCount - i;
+            int run = remaining;
+            if (logStay[state] < 0.0)
+                run = static_cast<int>(qMin<double>(remaining, 1.0 + floor(log(stream.nextUniform()) / logStay[state])));
+            if (run > 1)
+                logProbability += (run - 1) * logStay[state];
+            if (state != 0)
+                for (int j = i; j < i + run; ++j)
+                    packed[j] |= static_cast<unsigned>(state) << (2 * lane);
+            i += run;
+            if (i < stepCount)
+            {
+                int next = 0;
+                double v = last > 1 ? stream.nextUniform() : 0.0;
+                while (next < last && (next == state || v > switchCumulative[state][next]))
+                    ++next;
+                logProbability += logTransition[state][next];
+                state = next;
+            }
+        }
+        logProbabilities[lane] = logProbability;
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef REGIMESWITCHING_H
+#define REGIMESWITCHING_H
+#include <QVector>
+#include "randomstream.h"
+// Markov regime-switching returns with two or three regimes, ordered from
+// calmest to most volatile. In regime k the log price moves by
+// mean[k] - volatility[k]^2 / 2 + volatility[k] * z, and the regime of each
+// day follows the previous one with probabilities transition[from][to].
+// startProbabilities is the filtered regime distribution on the last
+// historical day.
+struct RegimeParameters
+{
+    int regimes;
+    double mean[3];
+    double volatility[3];
+    double transition[3][3];
+    double startProbabilities[3];
+};
+namespace RegimeSwitching {
+// Baum-Welch EM around a Hamilton filter (forward pass) and Kim smoother
+// (backward pass). The regime densities for the whole sample are computed
+// in one vectorised pass per iteration.
+RegimeParameters fit(const double *logReturns, int count, int regimes, int maxIterations = 200);
+// E[S_t / S_0] from the regime chain: start' (P D)^days 1 with
+// D = diag(exp(mean)).
+double expectedGrowth(const RegimeParameters &parameters, int days);
+}
+// Draws regime paths. Like JumpSampler every path is a pure function of the
+// seed and its index and antithetic pairs share their regimes. A block of up
+// to 16 paths is packed two bits per path into one word per step, the form
+// Simd::regimePaths consumes.
+class RegimeSampler
+{
+public:
+    RegimeSampler(const RegimeParameters &parameters, quint64 seed, bool antithetic, RandomStream::Generator generator,
+                  int steps);
+    int steps() const { return stepCount; }
+    // Writes packed regimes for paths firstPath .. firstPath + lanes - 1 and
+    // the log probability of each path's regime sequence.
+    void fillBlock(qint64 firstPath, int lanes, unsigned *packed, double *logProbabilities) const;
+private:
+    RegimeParameters params;
+    quint64 streamSeed;
+    bool pairs;
+    RandomStream::Generator engine;
+    int stepCount;
+    double startCumulative[3];
+    double switchCumulative[3][3];
+    double logStart[3];
+    double logStay[3];
+    double logTransition[3][3];
+};
+#endif
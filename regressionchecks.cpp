@@ -0,0 +1,247 @@
+#include "basketsimulator.h"
+#include "estimators.h"
+#include "montecarlo.h"
+#include "randomstream.h"
+#include "returnindex.h"
+#include "simdkernels.h"
+#include <QVector>
+#include <cmath>
+#include <cstdio>
+// Regression checks for the simulation engine, run without the GUI: every
+// model's paths agree across the scalar, AVX2 and AVX-512 kernels, do not
+// depend on the thread count, and average to the closed-form expected price.
+// Prints one line per check and exits non-zero if any fails.
+namespace {
+const int historyLength = 1000;
+const int pathDays = 64;
+const int pathCount = 20000;
+const double meanTolerance = 4.5;
+const double kernelTolerance = 1e-9;
+const double mismatchedPathShare = 1e-3;
+struct Scenario
+{
+    const char *name;
+    MonteCarlo::Model model;
+    MonteCarlo::ShockDistribution shocks;
+};
+const Scenario scenarios[] = {
+    {"GBM", MonteCarlo::GeometricBrownian, MonteCarlo::Gaussian},
+    {"jump-diffusion", MonteCarlo::JumpDiffusion, MonteCarlo::Gaussian},
+    {"Heston", MonteCarlo::Heston, MonteCarlo::Gaussian},
+    {"GARCH", MonteCarlo::Garch, MonteCarlo::Gaussian},
+    {"bootstrap", MonteCarlo::Bootstrap, MonteCarlo::Gaussian},
+    {"regime switching", MonteCarlo::RegimeSwitching, MonteCarlo::Gaussian},
+    {"Ornstein-Uhlenbeck", MonteCarlo::OrnsteinUhlenbeck, MonteCarlo::Gaussian},
+    {"variance gamma", MonteCarlo::VarianceGamma, MonteCarlo::Gaussian},
+    {"Student-t GBM", MonteCarlo::GeometricBrownian, MonteCarlo::StudentT},
+    {"skewed-t jump-diffusion", MonteCarlo::JumpDiffusion, MonteCarlo::SkewedStudentT},
+};
+int failures = 0;
+void report(bool passed, const char *check, const char *scenario, const char *detail)
+{
+    printf("%-4s %-22s %-24s %s\n", passed ? "ok" : "FAIL", check, scenario, detail);
+    if (!passed)
+        ++failures;
+}
+// GARCH(1,1) closes with occasional jumps, drawn from the repo's own Philox
+// stream so the history is the same with every standard library.
+QVector<double> syntheticHistory(quint64 seed, double drift)
+{
+    RandomStream stream(seed, 0);
+    QVector<double> shocks(historyLength);
+    QVector<double> uniforms(historyLength);
+    stream.fillNormals(shocks.data(), historyLength);
+    stream.fillUniforms(uniforms.data(), historyLength);
+    QVector<double> prices(historyLength + 1);
+    prices[0] = 100.0;
+    double variance = 1e-4;
+    for (int i = 0; i < historyLength; ++i)
+    {
+        double jump = uniforms[i] < 0.02 ? (uniforms[i] < 0.01 ? -0.05 : 0.04) : 0.0;
+        double r = drift + sqrt(variance) * shocks[i] + jump;
+        prices[i + 1] = prices[i] * exp(r);
+        variance = 2e-6 + 0.08 * (r - drift) * (r - drift) + 0.9 * variance;
+    }
+    return prices;
+}
+void configure(MonteCarlo &engine, const Scenario &scenario)
+{
+    engine.setModel(scenario.model);
+    engine.setShockDistribution(scenario.shocks);
+}
+// Values of two runs of the same paths, compared path by path. The vector
+// kernels use their own exp and log, so values may differ by rounding; a
+// variance gamma path may also take another branch when rounding flips a
+// gamma acceptance test, so a few whole paths are allowed to differ.
+bool sameValues(const SimulationResult &a, const SimulationResult &b, double tolerance, char *detail)
+{
+    if (a.pathCount() != b.pathCount() || a.dayCount() != b.dayCount())
+    {
+        sprintf(detail, "shapes differ");
+        return false;
+    }
+    int mismatched = 0;
+    double worst = 0.0;
+    for (int path = 0; path < a.pathCount(); ++path)
+    {
+        double difference = 0.0;
+        for (int day = 0; day < a.dayCount(); ++day)
+        {
+            double x = a.value(path, day), y = b.value(path, day);
+            difference = qMax(difference, fabs(x - y) / qMax(fabs(x), 1e-300));
+        }
+        double x = a.likelihoods()[path], y = b.likelihoods()[path];
+        difference = qMax(difference, fabs(x - y) / qMax(1.0, fabs(x)));
+        if (difference > tolerance)
+            ++mismatched;
+        else
+            worst = qMax(worst, difference);
+    }
+    sprintf(detail, "max rel diff %.2e, %d paths apart", worst, mismatched);
+    return tolerance == 0.0 ? mismatched == 0 : mismatched <= mismatchedPathShare * a.pathCount();
+}
+void checkInstructionSets(MonteCarlo &engine, const Scenario &scenario)
+{
+    const Simd::InstructionSet supported = Simd::supportedInstructionSet();
+    Simd::setInstructionSet(Simd::Scalar);
+    SimulationResult reference = engine.runLogSimulations(pathDays, pathCount / 4);
+    for (int set = Simd::Avx2; set <= supported; ++set)
+    {
+        Simd::setInstructionSet(static_cast<Simd::InstructionSet>(set));
+        char detail[96];
+        bool passed = sameValues(reference, engine.runLogSimulations(pathDays, pathCount / 4), kernelTolerance,
+                                 detail);
+        char check[32];
+        sprintf(check, "scalar vs %s", Simd::instructionSetName(static_cast<Simd::InstructionSet>(set)));
+        report(passed, check, scenario.name, detail);
+    }
+    Simd::setInstructionSet(supported);
+}
+void checkThreadCounts(MonteCarlo &engine, const Scenario &scenario)
+{
+    const int threads = engine.threadCount();
+    engine.setThreadCount(1);
+    SimulationResult single = engine.runSimulations(pathDays, pathCount / 4);
+    engine.setThreadCount(qMax(4, threads));
+    char detail[96];
+    bool passed = sameValues(single, engine.runSimulations(pathDays, pathCount / 4), 0.0, detail);
+    engine.setThreadCount(threads);
+    report(passed, "1 vs 4 threads", scenario.name, detail);
+}
+void checkMean(const char *check, const char *scenario, const SimulationResult &result, int column, double expected)
+{
+    Estimate mean = Estimators::mean(result, column);
+    double z = (mean.value - expected) / mean.standardError;
+    char detail[96];
+    sprintf(detail, "%.4f vs %.4f (%+.2f se)", mean.value, expected, z);
+    report(fabs(z) <= meanTolerance, check, scenario, detail);
+}
+void checkMeans(MonteCarlo &engine, const Scenario &scenario)
+{
+    SimulationResult paths = engine.runSimulations(pathDays, pathCount);
+    checkMean("daily path mean", scenario.name, paths, pathDays - 1, engine.expectedPrice(pathDays - 1));
+    QVector<int> horizons = {0, 21, 126};
+    SimulationResult ends = engine.runHorizons(horizons, pathCount);
+    checkMean("horizon mean", scenario.name, ends, 2, engine.expectedPrice(126));
+}
+// appendPrice, slideWindow and setHistoricalWindow against a fresh fit of the
+// same closes, for every close-based estimator.
+void checkIncrementalFits(const QVector<double> &history)
+{
+    const int window = 300;
+    const VolatilityEstimates::Estimator estimators[] = {VolatilityEstimates::CloseToClose,
+                                                         VolatilityEstimates::Ewma};
+    for (VolatilityEstimates::Estimator estimator : estimators)
+    {
+        MonteCarlo fresh;
+        fresh.setVolatilityEstimator(estimator);
+        fresh.setHistoricalPrices(history.mid(history.size() - window - 2));
+        MonteCarlo grown;
+        grown.setVolatilityEstimator(estimator);
+        grown.setHistoricalPrices(history.mid(history.size() - window - 2, window));
+        grown.appendPrice(history[history.size() - 2]);
+        grown.appendPrice(history.last());
+        MonteCarlo slid;
+        slid.setVolatilityEstimator(VolatilityEstimates::CloseToClose);
+        slid.setHistoricalWindow(ReturnIndex(history.mid(0, history.size() - 2)), window + 2);
+        slid.slideWindow(history[history.size() - 2]);
+        slid.slideWindow(history.last());
+        slid.setVolatilityEstimator(estimator);
+        double expected = fresh.dailyVolatility();
+        double difference = qMax(fabs(grown.dailyVolatility() - expected), fabs(slid.dailyVolatility() - expected));
+        char detail[96];
+        sprintf(detail, "volatility %.6f, worst diff %.2e", expected, difference);
+        report(difference <= 1e-10 * expected && fabs(grown.dailyDrift() - fresh.dailyDrift()) <= 1e-12,
+               "incremental refit", estimator == VolatilityEstimates::Ewma ? "EWMA" : "close-to-close", detail);
+    }
+}
+// Triangular and full products of the blocked multiply against a plain
+// triple loop, then basket determinism and means.
+void checkBasket()
+{
+    const int rows = 37, inner = 53, columns = 53;
+    QVector<double> a(rows * inner), b(inner * columns), out(rows * columns);
+    RandomStream stream(7, 0);
+    stream.fillNormals(a.data(), a.size());
+    stream.fillNormals(b.data(), b.size());
+    for (int triangular = 0; triangular < 2; ++triangular)
+    {
+        if (triangular)
+            for (int k = 0; k < inner; ++k)
+                for (int j = 0; j < k; ++j)
+                    b[k * columns + j] = 0.0;
+        Simd::multiply(a.constData(), rows, inner, b.constData(), columns, triangular, out.data());
+        double worst = 0.0;
+        for (int i = 0; i < rows; ++i)
+            for (int j = 0; j < columns; ++j)
+            {
+                double sum = 0.0;
+                for (int k = 0; k < inner; ++k)
+                    sum += a[i * inner + k] * b[k * columns + j];
+                worst = qMax(worst, fabs(out[i * columns + j] - sum));
+            }
+        char detail[96];
+        sprintf(detail, "max abs diff %.2e", worst);
+        report(worst <= 1e-12, "multiply vs naive", triangular ? "upper triangular" : "full", detail);
+    }
+    QVector<QVector<double>> histories;
+    for (int asset = 0; asset < 6; ++asset)
+        histories.append(syntheticHistory(100 + asset, 2e-4 * asset));
+    BasketSimulator basket;
+    basket.setHistoricalPrices(histories);
+    basket.setSeed(11);
+    QVector<int> horizons = {21, 126};
+    basket.setThreadCount(1);
+    QVector<SimulationResult> single = basket.runHorizons(horizons, pathCount / 4);
+    basket.setThreadCount(4);
+    QVector<SimulationResult> threaded = basket.runHorizons(horizons, pathCount / 4);
+    for (int asset = 0; asset < basket.assetCount(); ++asset)
+    {
+        char detail[96];
+        bool passed = sameValues(single[asset], threaded[asset], 0.0, detail);
+        report(passed, "1 vs 4 threads", "basket", detail);
+    }
+    QVector<SimulationResult> ends = basket.runHorizons(horizons, pathCount);
+    for (int asset = 0; asset < basket.assetCount(); ++asset)
+        checkMean("horizon mean", "basket", ends[asset], 1, basket.expectedPrice(asset, 126));
+}
+}
+int main()
+{
+    printf("Kernels: %s\n", Simd::instructionSetName(Simd::supportedInstructionSet()));
+    const QVector<double> history = syntheticHistory(42, 3e-4);
+    MonteCarlo engine;
+    engine.setHistoricalPrices(history);
+    engine.setSeed(2024);
+    for (const Scenario &scenario : scenarios)
+    {
+        configure(engine, scenario);
+        checkInstructionSets(engine, scenario);
+        checkThreadCounts(engine, scenario);
+        checkMeans(engine, scenario);
+    }
+    checkIncrementalFits(history);
+    checkBasket();
+    printf("%d failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
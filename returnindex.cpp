@@ -0,0 +1,44 @@
+#include "returnindex.h"
+#include <cmath>
+ReturnIndex::ReturnIndex() : offset(0.0)
+{
+}
+ReturnIndex::ReturnIndex(const QVector<double> &prices) : offset(0.0)
+{
+    closes.reserve(prices.size());
+    sums.reserve(prices.size());
+    squareSums.reserve(prices.size());
+    for (double price : prices)
+        append(price);
+}
+void ReturnIndex::append(double price)
+{
+    if (closes.isEmpty())
+    {
+        sums.append(0.0);
+        squareSums.append(0.0);
+    }
+    else
+    {
+        double value = log(price / closes.last());
+        if (closes.size() == 1)
+            offset = value;
+        double shifted = value - offset;
+        sums.append(sums.last() + shifted);
+        squareSums.append(squareSums.last() + shifted * shifted);
+    }
+    closes.append(price);
+}
+ReturnIndex::Moments ReturnIndex::window(int firstPrice, int lastPrice) const
+{
+    firstPrice = qMax(0, firstPrice);
+    lastPrice = qMin(priceCount() - 1, lastPrice);
+    Moments moments = {qMax(0, lastPrice - firstPrice), 0.0, 0.0};
+    if (moments.count == 0)
+        return moments;
+    double shiftedMean = (sums[lastPrice] - sums[firstPrice]) / moments.count;
+    double meanSquare = (squareSums[lastPrice] - squareSums[firstPrice]) / moments.count;
+    moments.mean = shiftedMean + offset;
+    moments.variance = qMax(0.0, meanSquare - shiftedMean * shiftedMean);
+    return moments;
+}
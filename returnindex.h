@@ -0,0 +1,32 @@
+#ifndef RETURNINDEX_H
+#define RETURNINDEX_H
+#include <QVector>
+// Prefix sums of log returns and squared log returns over a price history, so
+// the mean and variance of the returns in any window cost two subtractions.
+// Returns are offset by the first one before summing, which keeps the
+// squared sums from cancelling catastrophically on long histories.
+class ReturnIndex
+{
+public:
+    struct Moments
+    {
+        int count;
+        double mean;
+        double variance;
+    };
+    ReturnIndex();
+    explicit ReturnIndex(const QVector<double> &prices);
+    void append(double price);
+    int priceCount() const { return closes.size(); }
+    const QVector<double> &prices() const { return closes; }
+    // Moments of the returns between prices firstPrice and lastPrice
+    // (inclusive); variance is the population variance.
+    Moments window(int firstPrice, int lastPrice) const;
+    Moments lastPrices(int count) const { return window(priceCount() - count, priceCount() - 1); }
+private:
+    QVector<double> closes;
+    QVector<double> sums;
+    QVector<double> squareSums;
+    double offset;
+};
+#endif
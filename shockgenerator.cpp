@@ -0,0 +1,61 @@
+#include "shockgenerator.h"
+#include "distributions.h"
+#include <cmath>
+ShockGenerator::ShockGenerator(const Settings &settings, qint64 numPaths, const QVector<double> &stepLengths)
+    : config(settings), stepCount(stepLengths.size()), pointsPerReplicate(0),
+      bridge(settings.quasiRandom ? stepLengths : QVector<double>())
+{
+    if (config.tilt != 0.0)
+    {
+        shifts.resize(stepCount);
+        for (int i = 0; i < stepCount; ++i)
+            shifts[i] = config.tilt * sqrt(stepLengths[i]);
+    }
+    if (!config.quasiRandom)
+        return;
+    config.replicates = qMax(1, config.replicates);
+    qint64 basePaths = config.antithetic ? (numPaths + 1) / 2 : numPaths;
+    pointsPerReplicate = qMax<qint64>(1, (basePaths + config.replicates - 1) / config.replicates);
+    int dimensions = qMin(stepCount, SobolSequence::maxDimensions());
+    for (int r = 0; r < config.replicates; ++r)
+        sequences.emplace_back(dimensions, config.seed ^ (0x9E3779B97F4A7C15ULL * (r + 1)));
+}
+qint64 ShockGenerator::groupSize() const
+{
+    qint64 size = config.quasiRandom ? pointsPerReplicate : 1;
+    return config.antithetic ? 2 * size : size;
+}
+// With antithetic sampling paths 2k and 2k+1 share base index k, the second
+// one negated, so every pair is symmetric about the drift.
+double ShockGenerator::fill(qint64 path, double *shocks) const
+{
+    qint64 base = config.antithetic ? path / 2 : path;
+    if (config.quasiRandom && stepCount > 0)
+    {
+        const SobolSequence &sequence = sequences[base / pointsPerReplicate];
+        int dimensions = sequence.dimensions();
+        sequence.point(static_cast<quint32>(base % pointsPerReplicate), shocks);
+        for (int i = 0; i < dimensions; ++i)
+            shocks[i] = Distributions::inverseNormalCdf(shocks[i]);
+        RandomStream stream(config.seed, base, config.generator, config.normals);
+        stream.fillNormals(shocks + dimensions, stepCount - dimensions);
+        bridge.buildIncrements(shocks);
+    }
+    else
+    {
+        RandomStream stream(config.seed, base, config.generator, config.normals);
+        stream.fillNormals(shocks, stepCount);
+    }
+    if (config.antithetic && (path & 1))
+        for (int i = 0; i < stepCount; ++i)
+            shocks[i] = -shocks[i];
+    if (shifts.isEmpty())
+        return 0.0;
+    double logDensity = 0.0;
+    for (int i = 0; i < stepCount; ++i)
+    {
+        logDensity -= 0.5 * shocks[i] * shocks[i];
+        shocks[i] += shifts[i];
+    }
+    return logDensity;
+}
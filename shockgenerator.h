@@ -0,0 +1,46 @@
+#ifndef SHOCKGENERATOR_H
+#define SHOCKGENERATOR_H
+#include <QVector>
+#include <vector>
+#include "brownianbridge.h"
+#include "randomstream.h"
+#include "sobolsequence.h"
+// Produces the standard normal shocks that drive one path. Every path is a
+// pure function of the settings and its index, so paths can be generated in
+// any order on any thread. Pseudo-random paths read a RandomStream of the
+// chosen backend; with quasiRandom the leading Brownian-bridge dimensions
+// come from a scrambled Sobol point instead, one independent scramble per
+// replicate. A non-zero
+// tilt shifts the mean of every shock by tilt * sqrt(step length) for
+// importance sampling.
+class ShockGenerator
+{
+public:
+    struct Settings
+    {
+        quint64 seed;
+        bool antithetic;
+        bool quasiRandom;
+        int replicates;
+        double tilt;
+        RandomStream::Generator generator;
+        RandomStream::NormalMethod normals;
+    };
+    ShockGenerator(const Settings &settings, qint64 numPaths, const QVector<double> &stepLengths);
+    int steps() const { return stepCount; }
+    // Paths in a group are correlated; groups are independent.
+    qint64 groupSize() const;
+    bool isTilted() const { return config.tilt != 0.0; }
+    // Returns the log density of the draw under the sampling distribution
+    // (up to the same constant as the -z^2/2 likelihoods), or 0 when the
+    // generator is not tilted.
+    double fill(qint64 path, double *shocks) const;
+private:
+    Settings config;
+    int stepCount;
+    qint64 pointsPerReplicate;
+    QVector<double> shifts;
+    std::vector<SobolSequence> sequences;
+    BrownianBridge bridge;
+};
+#endif
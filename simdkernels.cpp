@@ -0,0 +1,573 @@
+#include "simdkernels.h"
+#include <QAtomicInt>
+#include <QtGlobal>
+#include <cmath>
+#ifdef MONTECARLO_X86_SIMD
+#define SIMD_DECLARE_KERNELS(ns) \
+    namespace ns { \
+    void boxMuller(double *values, int count); \
+    void gbmPaths(const double *shocks, const double *jumps, int steps, int lanes, double startPrice, double drift, \
+                  double volatility, double *out, size_t outStride, double *logLikelihoods); \
+    void logPaths(const double *shocks, const double *jumps, int steps, int lanes, double logStartPrice, double drift, \
+                  double volatility, double *out, size_t outStride, double *logLikelihoods); \
+    void hestonPaths(const double *priceShocks, const double *varianceShocks, int steps, int lanes, \
+                     double logStartPrice, const HestonParameters &model, bool logPrices, double *out, \
+                     size_t outStride, double *logLikelihoods); \
+    void garchPaths(const double *shocks, int steps, int lanes, double logStartPrice, const GarchParameters &model, \
+                    bool logPrices, double *out, size_t outStride, double *logLikelihoods); \
+    void ouPaths(const double *shocks, int steps, int lanes, double logStartPrice, double decay, double offset, \
+                 double deviation, bool logPrices, double *out, size_t outStride, double *logLikelihoods); \
+    void varianceGammaPaths(const double *shocks, const double *times, int steps, int lanes, double logStartPrice, \
+                            double drift, double skew, double volatility, bool logPrices, double *out, \
+                            size_t outStride, double *logLikelihoods); \
+    void gammaVariates(const double *normals, const double *uniforms, const double *boostUniforms, int count, \
+                       double shape, double scale, double *values, double *logValues); \
+    void regimePaths(const double *shocks, const unsigned *regimes, int steps, int lanes, double logStartPrice, \
+                     const double *drifts, const double *volatilities, bool logPrices, double *out, \
+                     size_t outStride, double *logLikelihoods); \
+    void garchLogLikelihoods(const double *residuals, int count, double startVariance, const double *omega, \
+                             const double *alpha, const double *beta, int candidates, double *logLikelihoods); \
+    void tabulatedShocks(double *shocks, int steps, int lanes, const double *table, int nodes, double firstNode, \
+                         double spacing, double *normalLogDensities, double *logDensities); \
+    void multiply(const double *a, int rows, int inner, const double *b, int columns, bool upperTriangular, \
+                  double *out); \
+    void gather(const double *table, const int *indices, int count, double *out); \
+    void expInPlace(double *values, size_t count); \
+    }
+SIMD_DECLARE_KERNELS(SimdAvx2)
+SIMD_DECLARE_KERNELS(SimdAvx512)
+#endif
+namespace {
+const double twoPi = 6.283185307179586476925286766559;
+QAtomicInt selectedSet(-1);
+void scalarBoxMuller(double *values, int count)
+{
+    int half = count / 2;
+    for (int i = 0; i < half; ++i)
+    {
+        double radius = sqrt(-2.0 * log(values[i]));
+        double angle = twoPi * values[half + i];
+        values[i] = radius * cos(angle);
+        values[half + i] = radius * sin(angle);
+    }
+}
+void scalarGbmPaths(const double *shocks, const double *jumps, int steps, int lanes, double startPrice, double drift,
+                    double volatility, double *out, size_t outStride, double *logLikelihoods)
+{
+    for (int lane = 0; lane < lanes; ++lane)
+    {
+        double price = startPrice;
+        double logLikelihood = 0.0;
+        out[lane] = price;
+        for (int i = 0; i < steps; ++i)
+        {
+            double randomShock = shocks[static_cast<size_t>(i) * lanes + lane];
+            double jump = jumps ? jumps[static_cast<size_t>(i) * lanes + lane] : 0.0;
+            price *= exp(drift + volatility * randomShock + jump);
+            logLikelihood -= 0.5 * randomShock * randomShock;
+            out[static_cast<size_t>(i + 1) * outStride + lane] = price;
+        }
+        logLikelihoods[lane] = logLikelihood;
+    }
+}
+void scalarLogPaths(const double *shocks, const double *jumps, int steps, int lanes, double logStartPrice, double drift,
+                    double volatility, double *out, size_t outStride, double *logLikelihoods)
+{
+    for (int lane = 0; lane < lanes; ++lane)
+    {
+        double logPrice = logStartPrice;
+        double logLikelihood = 0.0;
+        out[lane] = logPrice;
+        for (int i = 0; i < steps; ++i)
+        {
+            double randomShock = shocks[static_cast<size_t>(i) * lanes + lane];
+            double jump = jumps ? jumps[static_cast<size_t>(i) * lanes + lane] : 0.0;
+            logPrice += drift + volatility * randomShock + jump;
+            logLikelihood -= 0.5 * randomShock * randomShock;
+            out[static_cast<size_t>(i + 1) * outStride + lane] = logPrice;
+        }
+        logLikelihoods[lane] = logLikelihood;
+    }
+}
+void scalarHestonPaths(const double *priceShocks, const double *varianceShocks, int steps, int lanes,
+                       double logStartPrice, const HestonParameters &model, bool logPrices, double *out,
+                       size_t outStride, double *logLikelihoods)
+{
+    const double independent = sqrt(1.0 - model.correlation * model.correlation);
+    for (int lane = 0; lane < lanes; ++lane)
+    {
+        double logPrice = logStartPrice;
+        double variance = model.initialVariance;
+        double logLikelihood = 0.0;
+        out[lane] = logPrices ? logPrice : exp(logPrice);
+        for (int i = 0; i < steps; ++i)
+        {
+            double z = priceShocks[static_cast<size_t>(i) * lanes + lane];
+            double w = varianceShocks[static_cast<size_t>(i) * lanes + lane];
+            double truncated = variance > 0.0 ? variance : 0.0;
+            double root = sqrt(truncated);
+            logPrice += model.drift - 0.5 * truncated + root * (model.correlation * w + independent * z);
+            variance += model.meanReversion * (model.longRunVariance - truncated) + model.volatilityOfVariance * root * w;
+            logLikelihood -= 0.5 * z * z;
+            out[static_cast<size_t>(i + 1) * outStride + lane] = logPrices ? logPrice : exp(logPrice);
+        }
+        logLikelihoods[lane] = logLikelihood;
+    }
+}
+void scalarGarchPaths(const double *shocks, int steps, int lanes, double logStartPrice, const GarchParameters &model,
+                      bool logPrices, double *out, size_t outStride, double *logLikelihoods)
+{
+    for (int lane = 0; lane < lanes; ++lane)
+    {
+        double logPrice = logStartPrice;
+        double variance = model.initialVariance;
+        double logLikelihood = 0.0;
+        out[lane] = logPrices ? logPrice : exp(logPrice);
+        for (int i = 0; i < steps; ++i)
+        {
+            double z = shocks[static_cast<size_t>(i) * lanes + lane];
+            double innovation = sqrt(variance) * z;
+            logPrice += model.mean - 0.5 * variance + innovation;
+            variance = model.omega + model.alpha * innovation * innovation + model.beta * variance;
+            logLikelihood -= 0.5 * z * z;
+            out[static_cast<size_t>(i + 1) * outStride + lane] = logPrices ? logPrice : exp(logPrice);
+        }
+        logLikelihoods[lane] = logLikelihood;
+    }
+}
+void scalarOuPaths(const double *shocks, int steps, int lanes, double logStartPrice, double decay, double offset,
+                   double deviation, bool logPrices, double *out, size_t outStride, double *logLikelihoods)
+{
+    for (int lane = 0; lane < lanes; ++lane)
+    {
+        double logPrice = logStartPrice;
+        double likelihood = 0.0;
+        out[lane] = logPrices ? logPrice : exp(logPrice);
+        for (int i = 0; i < steps; ++i)
+        {
+            double z = shocks[static_cast<size_t>(i) * lanes + lane];
+            logPrice = offset + decay * logPrice + deviation * z;
+            likelihood -= 0.5 * z * z;
+            out[static_cast<size_t>(i + 1) * outStride + lane] = logPrices ? logPrice : exp(logPrice);
+        }
+        logLikelihoods[lane] = likelihood;
+    }
+}
+void scalarVarianceGammaPaths(const double *shocks, const double *times, int steps, int lanes, double logStartPrice,
+                              double drift, double skew, double volatility, bool logPrices, double *out,
+                              size_t outStride, double *logLikelihoods)
+{
+    for (int lane = 0; lane < lanes; ++lane)
+    {
+        double logPrice = logStartPrice;
+        double likelihood = 0.0;
+        out[lane] = logPrices ? logPrice : exp(logPrice);
+        for (int i = 0; i < steps; ++i)
+        {
+            double z = shocks[static_cast<size_t>(i) * lanes + lane];
+            double g = times[static_cast<size_t>(i) * lanes + lane];
+            logPrice += drift + skew * g + volatility * sqrt(g) * z;
+            likelihood -= 0.5 * z * z;
+            out[static_cast<size_t>(i + 1) * outStride + lane] = logPrices ? logPrice : exp(logPrice);
+        }
+        logLikelihoods[lane] = likelihood;
+    }
+}
+void scalarGammaVariates(const double *normals, const double *uniforms, const double *boostUniforms, int count,
+                         double shape, double scale, double *values, double *logValues)
+{
+    const bool boosted = shape < 1.0;
+    const double d = (boosted ? shape + 1.0 : shape) - 1.0 / 3.0;
+    const double c = 1.0 / sqrt(9.0 * d);
+    const double logScale = log(d * scale);
+    for (int i = 0; i < count; ++i)
+    {
+        double x = normals[i];
+        double t = 1.0 + c * x;
+        double v = t * t * t;
+        double logV = v > 0.0 ? log(v) : 0.0;
+        bool accepted = v > 0.0 && log(uniforms[i]) < 0.5 * x * x + d - d * v + d * logV;
+        double value = scale * d * v;
+        double logValue = logScale + logV;
+        if (boosted)
+        {
+            double logBoost = log(boostUniforms[i]) / shape;
+            value *= exp(logBoost);
+            logValue += logBoost;
+        }
+        values[i] = accepted ? value : -1.0;
+        logValues[i] = logValue;
+    }
+}
+void scalarRegimePaths(const double *shocks, const unsigned *regimes, int steps, int lanes, double logStartPrice,
+                       const double *drifts, const double *volatilities, bool logPrices, double *out,
+                       size_t outStride, double *logLikelihoods)
+{
+    for (int lane = 0; lane < lanes; ++lane)
+    {
+        double logPrice = logStartPrice;
+        double likelihood = 0.0;
+        out[lane] = logPrices ? logPrice : exp(logPrice);
+        for (int i = 0; i < steps; ++i)
+        {
+            int state = (regimes[i] >> (2 * lane)) & 3;
+            double z = shocks[static_cast<size_t>(i) * lanes + lane];
+            logPrice += drifts[state] + volatilities[state] * z;
+            likelihood -= 0.5 * z * z;
+            out[static_cast<size_t>(i + 1) * outStride + lane] = logPrices ? logPrice : exp(logPrice);
+        }
+        logLikelihoods[lane] = likelihood;
+    }
+}
+void scalarGarchLogLikelihoods(const double *residuals, int count, double startVariance, const double *omega,
+                               const double *alpha, const double *beta, int candidates, double *logLikelihoods)
+{
+    for (int c = 0; c < candidates; ++c)
+    {
+        double variance = startVariance;
+        double sum = 0.0;
+        for (int t = 0; t < count; ++t)
+        {
+            double square = residuals[t] * residuals[t];
+            sum += log(variance) + square / variance;
+            variance = omega[c] + alpha[c] * square + beta[c] * variance;
+        }
+        logLikelihoods[c] = -0.5 * sum;
+    }
+}
+void scalarTabulatedShocks(double *shocks, int steps, int lanes, const double *table, int nodes, double firstNode,
+                           double spacing, double *normalLogDensities, double *logDensities)
+{
+    const double last = nodes - 1 - 1e-9;
+    for (int lane = 0; lane < lanes; ++lane)
+    {
+        double normal = 0.0;
+        double density = 0.0;
+        for (int i = 0; i < steps; ++i)
+        {
+            double &z = shocks[static_cast<size_t>(i) * lanes + lane];
+            double x = qBound(0.0, (z - firstNode) / spacing, last);
+            int k = static_cast<int>(x);
+            double fraction = x - k;
+            const double *node = table + 2 * k;
+            normal -= 0.5 * z * z;
+            density += node[1] + fraction * (node[3] - node[1]);
+            z = node[0] + fraction * (node[2] - node[0]);
+        }
+        normalLogDensities[lane] = normal;
+        logDensities[lane] = density;
+    }
+}
+void scalarMultiply(const double *a, int rows, int inner, const double *b, int columns, bool upperTriangular,
+                    double *out)
+{
+    for (int r = 0; r < rows; ++r)
+    {
+        double *row = out + static_cast<size_t>(r) * columns;
+        for (int j = 0; j < columns; ++j)
+            row[j] = 0.0;
+        for (int k = 0; k < inner; ++k)
+        {
+            const double x = a[static_cast<size_t>(r) * inner + k];
+            const double *bk = b + static_cast<size_t>(k) * columns;
+            for (int j = upperTriangular ? k : 0; j < columns; ++j)
+                row[j] += x * bk[j];
+        }
+    }
+}
+}
+namespace Simd {
+InstructionSet supportedInstructionSet()
+{
+#ifdef MONTECARLO_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return Avx512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return Avx2;
+#endif
+    return Scalar;
+}
+InstructionSet activeInstructionSet()
+{
+    int set = selectedSet.loadAcquire();
+    if (set < 0)
+    {
+        set = supportedInstructionSet();
+        selectedSet.storeRelease(set);
+    }
+    return static_cast<InstructionSet>(set);
+}
+void setInstructionSet(InstructionSet set)
+{
+    selectedSet.storeRelease(qMin(static_cast<int>(set), static_cast<int>(supportedInstructionSet())));
+}
+const char *instructionSetName(InstructionSet set)
+{
+    switch (set)
+    {
+    case Avx512:
+        return "AVX-512";
+    case Avx2:
+        return "AVX2";
+    default:
+        return "Scalar";
+    }
+}
+void boxMuller(double *values, int count)
+{
+    switch (activeInstructionSet())
+    {
+#ifdef MONTECARLO_X86_SIMD
+    case Avx512:
+        SimdAvx512::boxMuller(values, count);
+        return;
+    case Avx2:
+        SimdAvx2::boxMuller(values, count);
+        return;
+#endif
+    default:
+        scalarBoxMuller(values, count);
+    }
+}
+void gbmPaths(const double *shocks, const double *jumps, int steps, int lanes, double startPrice, double drift,
+              double volatility, double *out, size_t outStride, double *logLikelihoods)
+{
+    switch (activeInstructionSet())
+    {
+#ifdef MONTECARLO_X86_SIMD
+    case Avx512:
+        SimdAvx512::gbmPaths(shocks, jumps, steps, lanes, startPrice, drift, volatility, out, outStride, logLikelihoods);
+        return;
+    case Avx2:
+        SimdAvx2::gbmPaths(shocks, jumps, steps, lanes, startPrice, drift, volatility, out, outStride, logLikelihoods);
+        return;
+#endif
+    default:
+        scalarGbmPaths(shocks, jumps, steps, lanes, startPrice, drift, volatility, out, outStride, logLikelihoods);
+    }
+}
+void logPaths(const double *shocks, const double *jumps, int steps, int lanes, double logStartPrice, double drift,
+              double volatility, double *out, size_t outStride, double *logLikelihoods)
+{
+    switch (activeInstructionSet())
+    {
+#ifdef MONTECARLO_X86_SIMD
+    case Avx512:
+        SimdAvx512::logPaths(shocks, jumps, steps, lanes, logStartPrice, drift, volatility, out, outStride, logLikelihoods);
+        return;
+    case Avx2:
+        SimdAvx2::logPaths(shocks, jumps, steps, lanes, logStartPrice, drift, volatility, out, outStride, logLikelihoods);
+        return;
+#endif
+    default:
+        scalarLogPaths(shocks, jumps, steps, lanes, logStartPrice, drift, volatility, out, outStride, logLikelihoods);
+    }
+}
+void hestonPaths(const double *priceShocks, const double *varianceShocks, int steps, int lanes, double logStartPrice,
+                 const HestonParameters &model, bool logPrices, double *out, size_t outStride,
+                 double *logLikelihoods)
+{
+    switch (activeInstructionSet())
+    {
+#ifdef MONTECARLO_X86_SIMD
+    case Avx512:
+        SimdAvx512::hestonPaths(priceShocks, varianceShocks, steps, lanes, logStartPrice, model, logPrices, out,
+                                outStride, logLikelihoods);
+        return;
+    case Avx2:
+        SimdAvx2::hestonPaths(priceShocks, varianceShocks, steps, lanes, logStartPrice, model, logPrices, out,
+                              outStride, logLikelihoods);
+        return;
+#endif
+    default:
+        scalarHestonPaths(priceShocks, varianceShocks, steps, lanes, logStartPrice, model, logPrices, out, outStride,
+                          logLikelihoods);
+    }
+}
+void garchPaths(const double *shocks, int steps, int lanes, double logStartPrice, const GarchParameters &model,
+                bool logPrices, double *out, size_t outStride, double *logLikelihoods)
+{
+    switch (activeInstructionSet())
+    {
+#ifdef MONTECARLO_X86_SIMD
+    case Avx512:
+        SimdAvx512::garchPaths(shocks, steps, lanes, logStartPrice, model, logPrices, out, outStride, logLikelihoods);
+        return;
+    case Avx2:
+        SimdAvx2::garchPaths(shocks, steps, lanes, logStartPrice, model, logPrices, out, outStride, logLikelihoods);
+        return;
+#endif
+    default:
+        scalarGarchPaths(shocks, steps, lanes, logStartPrice, model, logPrices, out, outStride, logLikelihoods);
+    }
+}
+void ouPaths(const double *shocks, int steps, int lanes, double logStartPrice, double decay, double offset,
+             double deviation, bool logPrices, double *out, size_t outStride, double *logLikelihoods)
+{
+    switch (activeInstructionSet())
+    {
+#ifdef MONTECARLO_X86_SIMD
+    case Avx512:
+        SimdAvx512::ouPaths(shocks, steps, lanes, logStartPrice, decay, offset, deviation, logPrices, out, outStride,
+                            logLikelihoods);
+        return;
+    case Avx2:
+        SimdAvx2::ouPaths(shocks, steps, lanes, logStartPrice, decay, offset, deviation, logPrices, out, outStride,
+                          logLikelihoods);
+        return;
+#endif
+    default:
+        scalarOuPaths(shocks, steps, lanes, logStartPrice, decay, offset, deviation, logPrices, out, outStride,
+                      logLikelihoods);
+    }
+}
+void varianceGammaPaths(const double *shocks, const double *times, int steps, int lanes, double logStartPrice,
+                        double drift, double skew, double volatility, bool logPrices, double *out, size_t outStride,
+                        double *logLikelihoods)
+{
+    switch (activeInstructionSet())
+    {
+#ifdef MONTECARLO_X86_SIMD
+    case Avx512:
+        SimdAvx512::varianceGammaPaths(shocks, times, steps, lanes, logStartPrice, drift, skew, volatility, logPrices,
+                                       out, outStride, logLikelihoods);
+        return;
+    case Avx2:
+        SimdAvx2::varianceGammaPaths(shocks, times, steps, lanes, logStartPrice, drift, skew, volatility, logPrices,
+                                     out, outStride, logLikelihoods);
+        return;
+#endif
+    default:
+        scalarVarianceGammaPaths(shocks, times, steps, lanes, logStartPrice, drift, skew, volatility, logPrices, out,
+                                 outStride, logLikelihoods);
+    }
+}
+void gammaVariates(const double *normals, const double *uniforms, const double *boostUniforms, int count,
+                   double shape, double scale, double *values, double *logValues)
+{
+    switch (activeInstructionSet())
+    {
+#ifdef MONTECARLO_X86_SIMD
+    case Avx512:
+        SimdAvx512::gammaVariates(normals, uniforms, boostUniforms, count, shape, scale, values, logValues);
+        return;
+    case Avx2:
+        SimdAvx2::gammaVariates(normals, uniforms, boostUniforms, count, shape, scale, values, logValues);
+        return;
+#endif
+    default:
+        scalarGammaVariates(normals, uniforms, boostUniforms, count, shape, scale, values, logValues);
+    }
+}
+void regimePaths(const double *shocks, const unsigned *regimes, int steps, int lanes, double logStartPrice,
+                 const double *drifts, const double *volatilities, bool logPrices, double *out, size_t outStride,
+                 double *logLikelihoods)
+{
+    switch (activeInstructionSet())
+    {
+#ifdef MONTECARLO_X86_SIMD
+    case Avx512:
+        SimdAvx512::regimePaths(shocks, regimes, steps, lanes, logStartPrice, drifts, volatilities, logPrices, out,
+                                outStride, logLikelihoods);
+        return;
+    case Avx2:
+        SimdAvx2::regimePaths(shocks, regimes, steps, lanes, logStartPrice, drifts, volatilities, logPrices, out,
+                              outStride, logLikelihoods);
+        return;
+#endif
+    default:
+        scalarRegimePaths(shocks, regimes, steps, lanes, logStartPrice, drifts, volatilities, logPrices, out,
+                          outStride, logLikelihoods);
+    }
+}
+void garchLogLikelihoods(const double *residuals, int count, double startVariance, const double *omega,
+                         const double *alpha, const double *beta, int candidates, double *logLikelihoods)
+{
+    switch (activeInstructionSet())
+    {
+#ifdef MONTECARLO_X86_SIMD
+    case Avx512:
+        SimdAvx512::garchLogLikelihoods(residuals, count, startVariance, omega, alpha, beta, candidates,
+                                        logLikelihoods);
+        return;
+    case Avx2:
+        SimdAvx2::garchLogLikelihoods(residuals, count, startVariance, omega, alpha, beta, candidates,
+                                      logLikelihoods);
+        return;
+#endif
+    default:
+        scalarGarchLogLikelihoods(residuals, count, startVariance, omega, alpha, beta, candidates, logLikelihoods);
+    }
+}
+void tabulatedShocks(double *shocks, int steps, int lanes, const double *table, int nodes, double firstNode,
+                     double spacing, double *normalLogDensities, double *logDensities)
+{
+    switch (activeInstructionSet())
+    {
+#ifdef MONTECARLO_X86_SIMD
+    case Avx512:
+        SimdAvx512::tabulatedShocks(shocks, steps, lanes, table, nodes, firstNode, spacing, normalLogDensities,
+                                    logDensities);
+        return;
+    case Avx2:
+        SimdAvx2::tabulatedShocks(shocks, steps, lanes, table, nodes, firstNode, spacing, normalLogDensities,
+                                  logDensities);
+        return;
+#endif
+    default:
+        scalarTabulatedShocks(shocks, steps, lanes, table, nodes, firstNode, spacing, normalLogDensities,
+                              logDensities);
+    }
+}
+void multiply(const double *a, int rows, int inner, const double *b, int columns, bool upperTriangular, double *out)
+{
+    switch (activeInstructionSet())
+    {
+#ifdef MONTECARLO_X86_SIMD
+    case Avx512:
+        SimdAvx512::multiply(a, rows, inner, b, columns, upperTriangular, out);
+        return;
+    case Avx2:
+        SimdAvx2::multiply(a, rows, inner, b, columns, upperTriangular, out);
+        return;
+#endif
+    default:
+        scalarMultiply(a, rows, inner, b, columns, upperTriangular, out);
+    }
+}
+void gather(const double *table, const int *indices, int count, double *out)
+{
+    switch (activeInstructionSet())
+    {
+#ifdef MONTECARLO_X86_SIMD
+    case Avx512:
+        SimdAvx512::gather(table, indices, count, out);
+        return;
+    case Avx2:
+        SimdAvx2::gather(table, indices, count, out);
+        return;
+#endif
+    default:
+        for (int i = 0; i < count; ++i)
+            out[i] = table[indices[i]];
+    }
+}
+void expInPlace(double *values, size_t count)
+{
+    switch (activeInstructionSet())
+    {
+#ifdef MONTECARLO_X86_SIMD
+    case Avx512:
+        SimdAvx512::expInPlace(values, count);
+        return;
+    case Avx2:
+        SimdAvx2::expInPlace(values, count);
+        return;
+#endif
+    default:
+        for (size_t i = 0; i < count; ++i)
+            values[i] = exp(values[i]);
+    }
+}
+}
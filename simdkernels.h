@@ -0,0 +1,90 @@
+#ifndef SIMDKERNELS_H
+#define SIMDKERNELS_H
+#include <cstddef>
+#include "garch.h"
+#include "heston.h"
+// Hot loops of the simulation engine. Each entry point dispatches at runtime
+// to an AVX-512 or AVX2 build of the same kernel when the CPU supports it and
+// falls back to scalar code otherwise. The vector builds use their own exp,
+// log and sin/cos approximations (accurate to a few ulp), so results for a
+// seed are reproducible per instruction set rather than across them.
+namespace Simd {
+enum InstructionSet
+{
+    Scalar,
+    Avx2,
+    Avx512
+};
+InstructionSet supportedInstructionSet();
+InstructionSet activeInstructionSet();
+void setInstructionSet(InstructionSet set);
+const char *instructionSetName(InstructionSet set);
+// Turns count/2 uniform pairs into normals in place: u1 is read from the
+// first half of values and u2 from the second half.
+void boxMuller(double *values, int count);
+// Advances `lanes` GBM paths by `steps` steps. shocks is step-major
+// (shocks[step * lanes + lane]); out receives day 0 (the start price) and
+// every step at out[day * outStride + lane]. jumps, when not null, holds
+// extra log increments in the same layout (jump-diffusion); they do not
+// enter logLikelihoods, which only covers the normal shocks.
+void gbmPaths(const double *shocks, const double *jumps, int steps, int lanes, double startPrice, double drift,
+              double volatility, double *out, size_t outStride, double *logLikelihoods);
+// Same layout as gbmPaths but writes log prices: a running sum of
+// drift + volatility * z with no exp in the loop.
+void logPaths(const double *shocks, const double *jumps, int steps, int lanes, double logStartPrice, double drift,
+              double volatility, double *out, size_t outStride, double *logLikelihoods);
+// Heston paths by full truncation: each step uses max(v, 0) as its variance,
+// so v may dip below zero between steps but never reaches a square root.
+// priceShocks holds the part of the price shock independent of
+// varianceShocks, both step-major like gbmPaths, and logLikelihoods covers
+// priceShocks only. Writes log prices when logPrices is set.
+void hestonPaths(const double *priceShocks, const double *varianceShocks, int steps, int lanes, double logStartPrice,
+                 const HestonParameters &model, bool logPrices, double *out, size_t outStride,
+                 double *logLikelihoods);
+// GARCH(1,1) paths, same layout as gbmPaths; the conditional variance is
+// carried per lane from model.initialVariance.
+void garchPaths(const double *shocks, int steps, int lanes, double logStartPrice, const GarchParameters &model,
+                bool logPrices, double *out, size_t outStride, double *logLikelihoods);
+// Mean-reverting log price paths, same layout as gbmPaths: each step maps
+// x to offset + decay * x + deviation * z.
+void ouPaths(const double *shocks, int steps, int lanes, double logStartPrice, double decay, double offset,
+             double deviation, bool logPrices, double *out, size_t outStride, double *logLikelihoods);
+// Variance-gamma paths, same layout as gbmPaths: each step adds
+// drift + skew * g + volatility * sqrt(g) * z for the step's gamma time
+// change g from `times`.
+void varianceGammaPaths(const double *shocks, const double *times, int steps, int lanes, double logStartPrice,
+                        double drift, double skew, double volatility, bool logPrices, double *out, size_t outStride,
+                        double *logLikelihoods);
+// Gamma(shape, scale) candidates by Marsaglia-Tsang from one normal and one
+// uniform each; shapes below 1 are drawn at shape + 1 and multiplied by
+// U^(1 / shape) from boostUniforms (ignored otherwise). Rejected candidates
+// get value -1 for the caller to redraw. logValues receives log(value).
+void gammaVariates(const double *normals, const double *uniforms, const double *boostUniforms, int count,
+                   double shape, double scale, double *values, double *logValues);
+// Regime-switching paths, same layout as gbmPaths. regimes holds one word
+// per step with the regime of lane j in bits 2j and 2j + 1 (so lanes <= 16);
+// drifts and volatilities are indexed by regime.
+void regimePaths(const double *shocks, const unsigned *regimes, int steps, int lanes, double logStartPrice,
+                 const double *drifts, const double *volatilities, bool logPrices, double *out, size_t outStride,
+                 double *logLikelihoods);
+// Gaussian GARCH(1,1) log likelihood (without the constant) of count
+// residuals for each of `candidates` (omega, alpha, beta) triples, the
+// candidates side by side in the vector lanes. The variance recursion
+// starts from startVariance.
+void garchLogLikelihoods(const double *residuals, int count, double startVariance, const double *omega,
+                         const double *alpha, const double *beta, int candidates, double *logLikelihoods);
+// Replaces each shock z of a step-major block by the linear interpolation of
+// a table of (value, log density) pairs at nodes firstNode + k * spacing,
+// clamping z to the node range. Per lane, normalLogDensities receives the
+// sum of -z^2/2 and logDensities the sum of interpolated log densities.
+void tabulatedShocks(double *shocks, int steps, int lanes, const double *table, int nodes, double firstNode,
+                     double spacing, double *normalLogDensities, double *logDensities);
+// out = a * b for row-major a (rows x inner), b (inner x columns) and out
+// (rows x columns). upperTriangular promises that b[k][j] = 0 for k > j, so
+// that part of each column is skipped.
+void multiply(const double *a, int rows, int inner, const double *b, int columns, bool upperTriangular, double *out);
+// out[i] = table[indices[i]].
+void gather(const double *table, const int *indices, int count, double *out);
+void expInPlace(double *values, size_t count);
+}
+#endif
@@ -0,0 +1,5 @@
+#ifdef MONTECARLO_X86_SIMD
+#define SIMD_WIDTH 4
+#define SIMD_NAMESPACE SimdAvx2
+#include "simdkernelsimpl.h"
+#endif
@@ -0,0 +1,5 @@
+#ifdef MONTECARLO_X86_SIMD
+#define SIMD_WIDTH 8
+#define SIMD_NAMESPACE SimdAvx512
+#include "simdkernelsimpl.h"
+#endif
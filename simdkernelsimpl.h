@@ -0,0 +1,712 @@
+#ifndef SIMDKERNELSIMPL_H
+#define SIMDKERNELSIMPL_H
+// Kernel bodies shared by the per-instruction-set translation units. Each unit
+// defines SIMD_WIDTH and SIMD_NAMESPACE, is compiled with the matching -m
+// flags and includes this file once. Helpers have internal linkage so the
+// differently compiled copies never get merged by the linker.
+#include <immintrin.h>
+#include <cstddef>
+#include <cstring>
+#include "garch.h"
+#include "heston.h"
+namespace {
+typedef double VecD __attribute__((vector_size(SIMD_WIDTH * 8)));
+typedef long long VecL __attribute__((vector_size(SIMD_WIDTH * 8)));
+const int width = SIMD_WIDTH;
+const double roundingMagic = 6755399441055744.0;
+const double log2e = 1.4426950408889634074;
+const double ln2 = 0.69314718055994530942;
+const double ln2Hi = 6.93147180369123816490e-01;
+const double ln2Lo = 1.90821492927058770002e-10;
+const double sqrt2 = 1.41421356237309504880;
+const double halfPi = 1.57079632679489661923;
+inline VecD broadcast(double value)
+{
+    VecD result = {};
+    return result + value;
+}
+inline VecD load(const double *p)
+{
+    VecD result;
+    memcpy(&result, p, sizeof(result));
+    return result;
+}
+inline void store(double *p, VecD value)
+{
+    memcpy(p, &value, sizeof(value));
+}
+inline VecD vfma(VecD a, VecD b, VecD c)
+{
+#if SIMD_WIDTH == 8
+    return (VecD)_mm512_fmadd_pd((__m512d)a, (__m512d)b, (__m512d)c);
+#else
+    return (VecD)_mm256_fmadd_pd((__m256d)a, (__m256d)b, (__m256d)c);
+#endif
+}
+inline VecD vsqrt(VecD x)
+{
+#if SIMD_WIDTH == 8
+    return (VecD)_mm512_maskz_sqrt_pd(0xFF, (__m512d)x);
+#else
+    return (VecD)_mm256_sqrt_pd((__m256d)x);
+#endif
+}
+inline VecD gatherAt(const double *table, const int *indices)
+{
+#if SIMD_WIDTH == 8
+    return (VecD)_mm512_mask_i32gather_pd(_mm512_setzero_pd(), 0xFF,
+                                          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(indices)), table, 8);
+#else
+    return (VecD)_mm256_mask_i32gather_pd(_mm256_setzero_pd(), table,
+                                          _mm_loadu_si128(reinterpret_cast<const __m128i *>(indices)),
+                                          _mm256_castsi256_pd(_mm256_set1_epi64x(-1)), 8);
+#endif
+}
+inline VecD gatherAt(const double *table, VecL indices)
+{
+#if SIMD_WIDTH == 8
+    return (VecD)_mm512_mask_i64gather_pd(_mm512_setzero_pd(), 0xFF, (__m512i)indices, table, 8);
+#else
+    return (VecD)_mm256_mask_i64gather_pd(_mm256_setzero_pd(), table, (__m256i)indices,
+                                          _mm256_castsi256_pd(_mm256_set1_epi64x(-1)), 8);
+#endif
+}
+inline VecD vexp(VecD x)
+{
+    x = x < broadcast(-708.0) ? broadcast(-708.0) : x;
+    x = x > broadcast(709.0) ? broadcast(709.0) : x;
+    VecD t = x * log2e + roundingMagic;
+    VecD n = t - roundingMagic;
+    VecL ni = (VecL)t - (VecL)broadcast(roundingMagic);
+    VecD r = x - n * ln2Hi - n * ln2Lo;
+    VecD p = broadcast(1.0 / 6227020800.0);
+    p = p * r + 1.0 / 479001600.0;
+    p = p * r + 1.0 / 39916800.0;
+    p = p * r + 1.0 / 3628800.0;
+    p = p * r + 1.0 / 362880.0;
+    p = p * r + 1.0 / 40320.0;
+    p = p * r + 1.0 / 5040.0;
+    p = p * r + 1.0 / 720.0;
+    p = p * r + 1.0 / 120.0;
+    p = p * r + 1.0 / 24.0;
+    p = p * r + 1.0 / 6.0;
+    p = p * r + 0.5;
+    p = p * r + 1.0;
+    p = p * r + 1.0;
+    return p * (VecD)((ni + 1023) << 52);
+}
+inline VecD vlog(VecD x)
+{
+    VecL bits = (VecL)x;
+    VecL exponent = ((bits >> 52) & 0x7ff) - 1023;
+    VecD m = (VecD)((bits & 0x000FFFFFFFFFFFFFLL) | 0x3FF0000000000000LL);
+    VecL big = m > sqrt2;
+    m = big ? m * 0.5 : m;
+    exponent = big ? exponent + 1 : exponent;
+    VecD e = (VecD)(exponent + (VecL)broadcast(roundingMagic)) - roundingMagic;
+    VecD f = (m - 1.0) / (m + 1.0);
+    VecD s = f * f;
+    VecD p = broadcast(1.0 / 21.0);
+    p = p * s + 1.0 / 19.0;
+    p = p * s + 1.0 / 17.0;
+    p = p * s + 1.0 / 15.0;
+    p = p * s + 1.0 / 13.0;
+    p = p * s + 1.0 / 11.0;
+    p = p * s + 1.0 / 9.0;
+    p = p * s + 1.0 / 7.0;
+    p = p * s + 1.0 / 5.0;
+    p = p * s + 1.0 / 3.0;
+    p = p * s + 1.0;
+    return e * ln2 + 2.0 * f * p;
+}
+// sin and cos of 2*pi*u for u in [0, 1): reduce to a quadrant and an angle
+// in [-pi/4, pi/4], where short Taylor series are exact to double precision.
+inline void vsincos2pi(VecD u, VecD &sine, VecD &cosine)
+{
+    VecD t = u * 4.0 + roundingMagic;
+    VecD q = t - roundingMagic;
+    VecL quadrant = ((VecL)t - (VecL)broadcast(roundingMagic)) & 3;
+    VecD a = (u * 4.0 - q) * halfPi;
+    VecD a2 = a * a;
+    VecD s = broadcast(1.0 / 355687428096000.0);
+    s = s * a2 - 1.0 / 1307674368000.0;
+    s = s * a2 + 1.0 / 6227020800.0;
+    s = s * a2 - 1.0 / 39916800.0;
+    s = s * a2 + 1.0 / 362880.0;
+    s = s * a2 - 1.0 / 5040.0;
+    s = s * a2 + 1.0 / 120.0;
+    s = s * a2 - 1.0 / 6.0;
+    s = s * a2 + 1.0;
+    s = s * a;
+    VecD c = broadcast(-1.0 / 6402373705728000.0);
+    c = c * a2 + 1.0 / 20922789888000.0;
+    c = c * a2 - 1.0 / 87178291200.0;
+    c = c * a2 + 1.0 / 479001600.0;
+    c = c * a2 - 1.0 / 3628800.0;
+    c = c * a2 + 1.0 / 40320.0;
+    c = c * a2 - 1.0 / 720.0;
+    c = c * a2 + 1.0 / 24.0;
+    c = c * a2 - 0.5;
+    c = c * a2 + 1.0;
+    VecL swap = (quadrant & 1) != 0;
+    VecD sw = swap ? c : s;
+    VecD cw = swap ? s : c;
+    sine = ((quadrant & 2) != 0) ? -sw : sw;
+    cosine = (((quadrant + 1) & 2) != 0) ? -cw : cw;
+}
+}
+namespace SIMD_NAMESPACE {
+void boxMuller(double *values, int count)
+{
+    int half = count / 2;
+    double *u1 = values;
+    double *u2 = values + half;
+    int i = 0;
+    for (; i + width <= half; i += width)
+    {
+        VecD radius = vsqrt(vlog(load(u1 + i)) * -2.0);
+        VecD sine, cosine;
+        vsincos2pi(load(u2 + i), sine, cosine);
+        store(u1 + i, radius * cosine);
+        store(u2 + i, radius * sine);
+    }
+    for (; i < half; ++i)
+    {
+        double radius = __builtin_sqrt(-2.0 * __builtin_log(u1[i]));
+        double angle = 4.0 * halfPi * u2[i];
+        u1[i] = radius * __builtin_cos(angle);
+        u2[i] = radius * __builtin_sin(angle);
+    }
+}
+void gbmPaths(const double *shocks, const double *jumps, int steps, int lanes, double startPrice, double drift,
+              double volatility, double *out, size_t outStride, double *logLikelihoods)
+{
+    int lane = 0;
+    for (; lane + width <= lanes; lane += width)
+    {
+        VecD price = broadcast(startPrice);
+        VecD likelihood = broadcast(0.0);
+        store(out + lane, price);
+        for (int i = 0; i < steps; ++i)
+        {
+            VecD z = load(shocks + static_cast<size_t>(i) * lanes + lane);
+            VecD step = drift + volatility * z;
+            if (jumps)
+                step += load(jumps + static_cast<size_t>(i) * lanes + lane);
+            price *= vexp(step);
+            likelihood -= 0.5 * z * z;
+            store(out + static_cast<size_t>(i + 1) * outStride + lane, price);
+        }
+        store(logLikelihoods + lane, likelihood);
+    }
+    for (; lane < lanes; ++lane)
+    {
+        double price = startPrice;
+        double likelihood = 0.0;
+        out[lane] = price;
+        for (int i = 0; i < steps; ++i)
+        {
+            double z = shocks[static_cast<size_t>(i) * lanes + lane];
+            double jump = jumps ? jumps[static_cast<size_t>(i) * lanes + lane] : 0.0;
+            price *= __builtin_exp(drift + volatility * z + jump);
+            likelihood -= 0.5 * z * z;
+            out[static_cast<size_t>(i + 1) * outStride + lane] = price;
+        }
+        logLikelihoods[lane] = likelihood;
+    }
+}
+void logPaths(const double *shocks, const double *jumps, int steps, int lanes, double logStartPrice, double drift,
+              double volatility, double *out, size_t outStride, double *logLikelihoods)
+{
+    int lane = 0;
+    for (; lane + width <= lanes; lane += width)
+    {
+        VecD logPrice = broadcast(logStartPrice);
+        VecD likelihood = broadcast(0.0);
+        store(out + lane, logPrice);
+        for (int i = 0; i < steps; ++i)
+        {
+            VecD z = load(shocks + static_cast<size_t>(i) * lanes + lane);
+            logPrice += drift + volatility * z;
+            if (jumps)
+                logPrice += load(jumps + static_cast<size_t>(i) * lanes + lane);
+            likelihood -= 0.5 * z * z;
+            store(out + static_cast<size_t>(i + 1) * outStride + lane, logPrice);
+        }
+        store(logLikelihoods + lane, likelihood);
+    }
+    for (; lane < lanes; ++lane)
+    {
+        double logPrice = logStartPrice;
+        double likelihood = 0.0;
+        out[lane] = logPrice;
+        for (int i = 0; i < steps; ++i)
+        {
+            double z = shocks[static_cast<size_t>(i) * lanes + lane];
+            double jump = jumps ? jumps[static_cast<size_t>(i) * lanes + lane] : 0.0;
+            logPrice += drift + volatility * z + jump;
+            likelihood -= 0.5 * z * z;
+            out[static_cast<size_t>(i + 1) * outStride + lane] = logPrice;
+        }
+        logLikelihoods[lane] = likelihood;
+    }
+}
+void hestonPaths(const double *priceShocks, const double *varianceShocks, int steps, int lanes, double logStartPrice,
+                 const HestonParameters &model, bool logPrices, double *out, size_t outStride,
+                 double *logLikelihoods)
+{
+    const double independent = __builtin_sqrt(1.0 - model.correlation * model.correlation);
+    int lane = 0;
+    for (; lane + width <= lanes; lane += width)
+    {
+        VecD logPrice = broadcast(logStartPrice);
+        VecD variance = broadcast(model.initialVariance);
+        VecD likelihood = broadcast(0.0);
+        store(out + lane, logPrices ? logPrice : vexp(logPrice));
+        for (int i = 0; i < steps; ++i)
+        {
+            VecD z = load(priceShocks + static_cast<size_t>(i) * lanes + lane);
+            VecD w = load(varianceShocks + static_cast<size_t>(i) * lanes + lane);
+            VecD truncated = variance > 0.0 ? variance : broadcast(0.0);
+            VecD root = vsqrt(truncated);
+            logPrice += model.drift - 0.5 * truncated + root * (model.correlation * w + independent * z);
+            variance += model.meanReversion * (model.longRunVariance - truncated) + model.volatilityOfVariance * root * w;
+            likelihood -= 0.5 * z * z;
+            store(out + static_cast<size_t>(i + 1) * outStride + lane, logPrices ? logPrice : vexp(logPrice));
+        }
+        store(logLikelihoods + lane, likelihood);
+    }
+    for (; lane < lanes; ++lane)
+    {
+        double logPrice = logStartPrice;
+        double variance = model.initialVariance;
+        double likelihood = 0.0;
+        out[lane] = logPrices ? logPrice : __builtin_exp(logPrice);
+        for (int i = 0; i < steps; ++i)
+        {
+            double z = priceShocks[static_cast<size_t>(i) * lanes + lane];
+            double w = varianceShocks[static_cast<size_t>(i) * lanes + lane];
+            double truncated = variance > 0.0 ? variance : 0.0;
+            double root = __builtin_sqrt(truncated);
+            logPrice += model.drift - 0.5 * truncated + root * (model.correlation * w + independent * z);
+            variance += model.meanReversion * (model.longRunVariance - truncated) + model.volatilityOfVariance * root * w;
+            likelihood -= 0.5 * z * z;
+            out[static_cast<size_t>(i + 1) * outStride + lane] = logPrices ? logPrice : __builtin_exp(logPrice);
+        }
+        logLikelihoods[lane] = likelihood;
+    }
+}
+void garchPaths(const double *shocks, int steps, int lanes, double logStartPrice, const GarchParameters &model,
+                bool logPrices, double *out, size_t outStride, double *logLikelihoods)
+{
+    int lane = 0;
+    for (; lane + width <= lanes; lane += width)
+    {
+        VecD logPrice = broadcast(logStartPrice);
+        VecD variance = broadcast(model.initialVariance);
+        VecD likelihood = broadcast(0.0);
+        store(out + lane, logPrices ? logPrice : vexp(logPrice));
+        for (int i = 0; i < steps; ++i)
+        {
+            VecD z = load(shocks + static_cast<size_t>(i) * lanes + lane);
+            VecD innovation = vsqrt(variance) * z;
+            logPrice += model.mean - 0.5 * variance + innovation;
+            variance = model.omega + model.alpha * innovation * innovation + model.beta * variance;
+            likelihood -= 0.5 * z * z;
+            store(out + static_cast<size_t>(i + 1) * outStride + lane, logPrices ? logPrice : vexp(logPrice));
+        }
+        store(logLikelihoods + lane, likelihood);
+    }
+    for (; lane < lanes; ++lane)
+    {
+        double logPrice = logStartPrice;
+        double variance = model.initialVariance;
+        double likelihood = 0.0;
+        out[lane] = logPrices ? logPrice : __builtin_exp(logPrice);
+        for (int i = 0; i < steps; ++i)
+        {
+            double z = shocks[static_cast<size_t>(i) * lanes + lane];
+            double innovation = __builtin_sqrt(variance) * z;
+            logPrice += model.mean - 0.5 * variance + innovation;
+            variance = model.omega + model.alpha * innovation * innovation + model.beta * variance;
+            likelihood -= 0.5 * z * z;
+            out[static_cast<size_t>(i + 1) * outStride + lane] = logPrices ? logPrice : __builtin_exp(logPrice);
+        }
+        logLikelihoods[lane] = likelihood;
+    }
+}
+void ouPaths(const double *shocks, int steps, int lanes, double logStartPrice, double decay, double offset,
+             double deviation, bool logPrices, double *out, size_t outStride, double *logLikelihoods)
+{
+    int lane = 0;
+    for (; lane + width <= lanes; lane += width)
+    {
+        VecD logPrice = broadcast(logStartPrice);
+        VecD likelihood = broadcast(0.0);
+        store(out + lane, logPrices ? logPrice : vexp(logPrice));
+        for (int i = 0; i < steps; ++i)
+        {
+            VecD z = load(shocks + static_cast<size_t>(i) * lanes + lane);
+            logPrice = offset + decay * logPrice + deviation * z;
+            likelihood -= 0.5 * z * z;
+            store(out + static_cast<size_t>(i + 1) * outStride + lane, logPrices ? logPrice : vexp(logPrice));
+        }
+        store(logLikelihoods + lane, likelihood);
+    }
+    for (; lane < lanes; ++lane)
+    {
+        double logPrice = logStartPrice;
+        double likelihood = 0.0;
+        out[lane] = logPrices ? logPrice : __builtin_exp(logPrice);
+        for (int i = 0; i < steps; ++i)
+        {
+            double z = shocks[static_cast<size_t>(i) * lanes + lane];
+            logPrice = offset + decay * logPrice + deviation * z;
+            likelihood -= 0.5 * z * z;
+            out[static_cast<size_t>(i + 1) * outStride + lane] = logPrices ? logPrice : __builtin_exp(logPrice);
+        }
+        logLikelihoods[lane] = likelihood;
+    }
+}
+void varianceGammaPaths(const double *shocks, const double *times, int steps, int lanes, double logStartPrice,
+                        double drift, double skew, double volatility, bool logPrices, double *out, size_t outStride,
+                        double *logLikelihoods)
+{
+    int lane = 0;
+    for (; lane + width <= lanes; lane += width)
+    {
+        VecD logPrice = broadcast(logStartPrice);
+        VecD likelihood = broadcast(0.0);
+        store(out + lane, logPrices ? logPrice : vexp(logPrice));
+        for (int i = 0; i < steps; ++i)
+        {
+            VecD z = load(shocks + static_cast<size_t>(i) * lanes + lane);
+            VecD g = load(times + static_cast<size_t>(i) * lanes + lane);
+            logPrice += drift + skew * g + volatility * vsqrt(g) * z;
+            likelihood -= 0.5 * z * z;
+            store(out + static_cast<size_t>(i + 1) * outStride + lane, logPrices ? logPrice : vexp(logPrice));
+        }
+        store(logLikelihoods + lane, likelihood);
+    }
+    for (; lane < lanes; ++lane)
+    {
+        double logPrice = logStartPrice;
+        double likelihood = 0.0;
+        out[lane] = logPrices ? logPrice : __builtin_exp(logPrice);
+        for (int i = 0; i < steps; ++i)
+        {
+            double z = shocks[static_cast<size_t>(i) * lanes + lane];
+            double g = times[static_cast<size_t>(i) * lanes + lane];
+            logPrice += drift + skew * g + volatility * __builtin_sqrt(g) * z;
+            likelihood -= 0.5 * z * z;
+            out[static_cast<size_t>(i + 1) * outStride + lane] = logPrices ? logPrice : __builtin_exp(logPrice);
+        }
+        logLikelihoods[lane] = likelihood;
+    }
+}
+// Marsaglia-Tsang: one normal x and one uniform u per candidate, accepted
+// when log u < x^2 / 2 + d - d v + d log v, which needs only one vector log.
+// The tests are evaluated for every candidate and the outcome is written as
+// a sign, so there is no branch in the loop.
+void gammaVariates(const double *normals, const double *uniforms, const double *boostUniforms, int count,
+                   double shape, double scale, double *values, double *logValues)
+{
+    const bool boosted = shape < 1.0;
+    const double d = (boosted ? shape + 1.0 : shape) - 1.0 / 3.0;
+    const double c = 1.0 / __builtin_sqrt(9.0 * d);
+    const double inverseShape = 1.0 / shape;
+    const double logScale = __builtin_log(d * scale);
+    int i = 0;
+    for (; i + width <= count; i += width)
+    {
+        VecD x = load(normals + i);
+        VecD t = 1.0 + c * x;
+        VecD v = t * t * t;
+        VecD logV = vlog(v > 0.0 ? v : broadcast(1.0));
+        VecL accepted = (v > 0.0) & (vlog(load(uniforms + i)) < 0.5 * x * x + d - d * v + d * logV);
+        VecD value = scale * d * v;
+        VecD logValue = logScale + logV;
+        if (boosted)
+        {
+            VecD logBoost = vlog(load(boostUniforms + i)) * inverseShape;
+            value *= vexp(logBoost);
+            logValue += logBoost;
+        }
+        store(values + i, accepted ? value : broadcast(-1.0));
+        store(logValues + i, logValue);
+    }
+    for (; i < count; ++i)
+    {
+        double x = normals[i];
+        double t = 1.0 + c * x;
+        double v = t * t * t;
+        double logV = v > 0.0 ? __builtin_log(v) : 0.0;
+        bool accepted = v > 0.0 && __builtin_log(uniforms[i]) < 0.5 * x * x + d - d * v + d * logV;
+        double value = scale * d * v;
+        double logValue = logScale + logV;
+        if (boosted)
+        {
+            double logBoost = __builtin_log(boostUniforms[i]) * inverseShape;
+            value *= __builtin_exp(logBoost);
+            logValue += logBoost;
+        }
+        values[i] = accepted ? value : -1.0;
+        logValues[i] = logValue;
+    }
+}
+// Each lane extracts its two-bit regime from the step's packed word with a
+// variable shift and selects drift and volatility by comparison, which is
+// cheaper than a gather from three-entry tables.
+void regimePaths(const double *shocks, const unsigned *regimes, int steps, int lanes, double logStartPrice,
+                 const double *drifts, const double *volatilities, bool logPrices, double *out, size_t outStride,
+                 double *logLikelihoods)
+{
+    int lane = 0;
+    for (; lane + width <= lanes; lane += width)
+    {
+        VecL shifts;
+        for (int j = 0; j < width; ++j)
+            shifts[j] = 2 * (lane + j);
+        VecD logPrice = broadcast(logStartPrice);
+        VecD likelihood = broadcast(0.0);
+        store(out + lane, logPrices ? logPrice : vexp(logPrice));
+        for (int i = 0; i < steps; ++i)
+        {
+            VecL word = {};
+            VecL state = ((word + static_cast<long long>(regimes[i])) >> shifts) & 3;
+            VecD drift = state == 0 ? broadcast(drifts[0]) : state == 1 ? broadcast(drifts[1]) : broadcast(drifts[2]);
+            VecD volatility = state == 0 ? broadcast(volatilities[0])
+                                         : state == 1 ? broadcast(volatilities[1]) : broadcast(volatilities[2]);
+            VecD z = load(shocks + static_cast<size_t>(i) * lanes + lane);
+            logPrice += drift + volatility * z;
+            likelihood -= 0.5 * z * z;
+            store(out + static_cast<size_t>(i + 1) * outStride + lane, logPrices ? logPrice : vexp(logPrice));
+        }
+        store(logLikelihoods + lane, likelihood);
+    }
+    for (; lane < lanes; ++lane)
+    {
+        double logPrice = logStartPrice;
+        double likelihood = 0.0;
+        out[lane] = logPrices ? logPrice : __builtin_exp(logPrice);
+        for (int i = 0; i < steps; ++i)
+        {
+            int state = (regimes[i] >> (2 * lane)) & 3;
+            double z = shocks[static_cast<size_t>(i) * lanes + lane];
+            logPrice += drifts[state] + volatilities[state] * z;
+            likelihood -= 0.5 * z * z;
+            out[static_cast<size_t>(i + 1) * outStride + lane] = logPrices ? logPrice : __builtin_exp(logPrice);
+        }
+        logLikelihoods[lane] = likelihood;
+    }
+}
+// The candidates' recursions are independent, so the vector runs across
+// candidates and each residual is broadcast to all lanes. The log variances
+// are summed as the log of a running product of variance / startVariance,
+// taken every 16 steps, which keeps a single division in the per-step work.
+void garchLogLikelihoods(const double *residuals, int count, double startVariance, const double *omega,
+                         const double *alpha, const double *beta, int candidates, double *logLikelihoods)
+{
+    const double scale = 1.0 / startVariance;
+    int c = 0;
+    for (; c + width <= candidates; c += width)
+    {
+        VecD w = load(omega + c);
+        VecD a = load(alpha + c);
+        VecD b = load(beta + c);
+        VecD variance = broadcast(startVariance);
+        VecD sum = broadcast(count * __builtin_log(startVariance));
+        VecD product = broadcast(1.0);
+        for (int t = 0; t < count; ++t)
+        {
+            double square = residuals[t] * residuals[t];
+            sum += square / variance;
+            product *= variance * scale;
+            if ((t & 15) == 15)
+            {
+                sum += vlog(product);
+                product = broadcast(1.0);
+            }
+            variance = w + a * square + b * variance;
+        }
+        store(logLikelihoods + c, -0.5 * (sum + vlog(product)));
+    }
+    for (; c < candidates; ++c)
+    {
+        double variance = startVariance;
+        double sum = 0.0;
+        for (int t = 0; t < count; ++t)
+        {
+            double square = residuals[t] * residuals[t];
+            sum += __builtin_log(variance) + square / variance;
+            variance = omega[c] + alpha[c] * square + beta[c] * variance;
+        }
+        logLikelihoods[c] = -0.5 * sum;
+    }
+}
+void tabulatedShocks(double *shocks, int steps, int lanes, const double *table, int nodes, double firstNode,
+                     double spacing, double *normalLogDensities, double *logDensities)
+{
+    const double inverseSpacing = 1.0 / spacing;
+    const double last = nodes - 1 - 1e-9;
+    int lane = 0;
+    for (; lane + width <= lanes; lane += width)
+    {
+        VecD normal = broadcast(0.0);
+        VecD density = broadcast(0.0);
+        for (int i = 0; i < steps; ++i)
+        {
+            double *row = shocks + static_cast<size_t>(i) * lanes + lane;
+            VecD z = load(row);
+            VecD x = (z - firstNode) * inverseSpacing;
+            x = x < 0.0 ? broadcast(0.0) : x;
+            x = x > last ? broadcast(last) : x;
+            VecD t = x - 0.5 + roundingMagic;
+            VecL pair = ((VecL)t - (VecL)broadcast(roundingMagic)) * 2;
+            VecD fraction = x - (t - roundingMagic);
+            VecD value = gatherAt(table, pair);
+            VecD logDensity = gatherAt(table + 1, pair);
+            normal -= 0.5 * z * z;
+            density += logDensity + fraction * (gatherAt(table + 3, pair) - logDensity);
+            store(row, value + fraction * (gatherAt(table + 2, pair) - value));
+        }
+        store(normalLogDensities + lane, normal);
+        store(logDensities + lane, density);
+    }
+    for (; lane < lanes; ++lane)
+    {
+        double normal = 0.0;
+        double density = 0.0;
+        for (int i = 0; i < steps; ++i)
+        {
+            double &z = shocks[static_cast<size_t>(i) * lanes + lane];
+            double x = (z - firstNode) * inverseSpacing;
+            x = x < 0.0 ? 0.0 : (x > last ? last : x);
+            int k = static_cast<int>(x);
+            double fraction = x - k;
+            const double *node = table + 2 * k;
+            normal -= 0.5 * z * z;
+            density += node[1] + fraction * (node[3] - node[1]);
+            z = node[0] + fraction * (node[2] - node[0]);
+        }
+        normalLogDensities[lane] = normal;
+        logDensities[lane] = density;
+    }
+}
+// Blocked product: b is copied a panel of 2 vectors wide and packDepth rows
+// deep at a time into a contiguous buffer that stays in L1, and each pass
+// keeps a 4-row by 2-vector tile of out in registers while it streams that
+// buffer. With upperTriangular the panels stop at the diagonal, since rows
+// of b below it are zero.
+void multiply(const double *a, int rows, int inner, const double *b, int columns, bool upperTriangular, double *out)
+{
+    const int panel = 2 * width;
+    const int packDepth = 256;
+    double packed[packDepth * 2 * SIMD_WIDTH];
+    int j = 0;
+    for (; j + panel <= columns; j += panel)
+    {
+        const int depth = upperTriangular && j + panel < inner ? j + panel : inner;
+        for (int k0 = 0; k0 < depth || k0 == 0; k0 += packDepth)
+        {
+            const int k1 = k0 + packDepth < depth ? k0 + packDepth : depth;
+            for (int k = k0; k < k1; ++k)
+                memcpy(packed + (k - k0) * panel, b + static_cast<size_t>(k) * columns + j, panel * sizeof(double));
+            const int count = k1 - k0;
+            int r = 0;
+            for (; r + 4 <= rows; r += 4)
+            {
+                const double *a0 = a + static_cast<size_t>(r) * inner + k0;
+                const double *a1 = a0 + inner;
+                const double *a2 = a1 + inner;
+                const double *a3 = a2 + inner;
+                double *o = out + static_cast<size_t>(r) * columns + j;
+                VecD c00 = {}, c01 = {}, c10 = {}, c11 = {}, c20 = {}, c21 = {}, c30 = {}, c31 = {};
+                if (k0 > 0)
+                {
+                    c00 = load(o);
+                    c01 = load(o + width);
+                    c10 = load(o + columns);
+                    c11 = load(o + columns + width);
+                    c20 = load(o + 2 * columns);
+                    c21 = load(o + 2 * columns + width);
+                    c30 = load(o + 3 * columns);
+                    c31 = load(o + 3 * columns + width);
+                }
+                for (int k = 0; k < count; ++k)
+                {
+                    VecD b0 = load(packed + k * panel);
+                    VecD b1 = load(packed + k * panel + width);
+                    VecD x = broadcast(a0[k]);
+                    c00 = vfma(x, b0, c00);
+                    c01 = vfma(x, b1, c01);
+                    x = broadcast(a1[k]);
+                    c10 = vfma(x, b0, c10);
+                    c11 = vfma(x, b1, c11);
+                    x = broadcast(a2[k]);
+                    c20 = vfma(x, b0, c20);
+                    c21 = vfma(x, b1, c21);
+                    x = broadcast(a3[k]);
+                    c30 = vfma(x, b0, c30);
+                    c31 = vfma(x, b1, c31);
+                }
+                store(o, c00);
+                store(o + width, c01);
+                store(o + columns, c10);
+                store(o + columns + width, c11);
+                store(o + 2 * columns, c20);
+                store(o + 2 * columns + width, c21);
+                store(o + 3 * columns, c30);
+                store(o + 3 * columns + width, c31);
+            }
+            for (; r < rows; ++r)
+            {
+                const double *a0 = a + static_cast<size_t>(r) * inner + k0;
+                double *o = out + static_cast<size_t>(r) * columns + j;
+                VecD c0 = {}, c1 = {};
+                if (k0 > 0)
+                {
+                    c0 = load(o);
+                    c1 = load(o + width);
+                }
+                for (int k = 0; k < count; ++k)
+                {
+                    VecD x = broadcast(a0[k]);
+                    c0 = vfma(x, load(packed + k * panel), c0);
+                    c1 = vfma(x, load(packed + k * panel + width), c1);
+                }
+                store(o, c0);
+                store(o + width, c1);
+            }
+        }
+    }
+    for (; j < columns; ++j)
+    {
+        const int depth = upperTriangular && j + 1 < inner ? j + 1 : inner;
+        for (int r = 0; r < rows; ++r)
+        {
+            double sum = 0.0;
+            for (int k = 0; k < depth; ++k)
+                sum += a[static_cast<size_t>(r) * inner + k] * b[static_cast<size_t>(k) * columns + j];
+            out[static_cast<size_t>(r) * columns + j] = sum;
+        }
+    }
+}
+void gather(const double *table, const int *indices, int count, double *out)
+{
+    int i = 0;
+    for (; i + width <= count; i += width)
+        store(out + i, gatherAt(table, indices + i));
+    for (; i < count; ++i)
+        out[i] = table[indices[i]];
+}
+void expInPlace(double *values, size_t count)
+{
+    size_t i = 0;
+    for (; i + width <= count; i += width)
+        store(values + i, vexp(load(values + i)));
+    for (; i < count; ++i)
+        values[i] = __builtin_exp(values[i]);
+}
+}
+#endif
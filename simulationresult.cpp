@@ -0,0 +1,97 @@
+#include "simulationresult.h"
+#include "simdkernels.h"
+#include <algorithm>
+#include <cmath>
+SimulationView::SimulationView(const double *data, int size, int stride)
+    : values(data), count(size), step(stride)
+{
+}
+QVector<double> SimulationView::toVector() const
+{
+    QVector<double> result(count);
+    for (int i = 0; i < count; ++i)
+        result[i] = (*this)[i];
+    return result;
+}
+SimulationResult::SimulationResult() : paths(0), days(0), valueScale(Price), group(1)
+{
+}
+SimulationResult::SimulationResult(int numPaths, int numDays)
+    : paths(numPaths), days(numDays), valueScale(Price), group(1),
+      values(static_cast<size_t>(numPaths) * numDays),
+      logLikelihoods(numPaths)
+{
+}
+SimulationView SimulationResult::path(int path) const
+{
+    return SimulationView(values.data() + path, days, paths);
+}
+SimulationView SimulationResult::day(int day) const
+{
+    return SimulationView(dayData(day), paths, 1);
+}
+double SimulationResult::weight(int path) const
+{
+    return logWeightValues.isEmpty() ? 1.0 : exp(logWeightValues[path]);
+}
+SimulationResult SimulationResult::firstPaths(int count) const
+{
+    count = qBound(0, count, paths);
+    SimulationResult result(count, days);
+    result.valueScale = valueScale;
+    result.group = group;
+    result.offsets = offsets;
+    for (int day = 0; day < days; ++day)
+        std::copy(dayData(day), dayData(day) + count, result.dayData(day));
+    result.logLikelihoods = logLikelihoods.mid(0, count);
+    if (isWeighted())
+        result.logWeightValues = logWeightValues.mid(0, count);
+    return result;
+}
+int SimulationResult::mostLikelyPath() const
+{
+    if (logLikelihoods.isEmpty())
+        return -1;
+    return std::distance(logLikelihoods.begin(), std::max_element(logLikelihoods.begin(), logLikelihoods.end()));
+}
+void SimulationResult::toPrices()
+{
+    if (valueScale == LogPrice)
+        Simd::expInPlace(values.data(), values.size());
+    valueScale = Price;
+}
+// Order statistics commute with exp, so a log-price result only
+// exponentiates the two selected neighbours; interpolating between them in
+// price space keeps the answer identical to that of a price result.
+double SimulationResult::quantile(int day, double probability) const
+{
+    if (paths == 0)
+        return 0.0;
+    QVector<double> sorted = this->day(day).toVector();
+    double position = qBound(0.0, probability, 1.0) * (paths - 1);
+    int lower = static_cast<int>(position);
+    std::nth_element(sorted.begin(), sorted.begin() + lower, sorted.end());
+    double result = valueScale == LogPrice ? exp(sorted[lower]) : sorted[lower];
+    if (lower + 1 < paths)
+    {
+        double upper = *std::min_element(sorted.begin() + lower + 1, sorted.end());
+        if (valueScale == LogPrice)
+            upper = exp(upper);
+        result += (position - lower) * (upper - result);
+    }
+    return result;
+}
+QuantileSummary::QuantileSummary() : days(0), paths(0)
+{
+}
+QuantileSummary::QuantileSummary(int numDays, const QVector<double> &probabilities, qint64 numPaths)
+    : days(numDays), paths(numPaths), levels(probabilities), values(numDays * probabilities.size())
+{
+}
+QVector<double> QuantileSummary::band(int level) const
+{
+    QVector<double> result(days);
+    for (int day = 0; day < days; ++day)
+        result[day] = value(day, level);
+    return result;
+}
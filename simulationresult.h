@@ -0,0 +1,96 @@
+#ifndef SIMULATIONRESULT_H
+#define SIMULATIONRESULT_H
+#include <QVector>
+#include <vector>
+class SimulationView
+{
+public:
+    SimulationView(const double *data, int size, int stride);
+    int size() const { return count; }
+    int stride() const { return step; }
+    double operator[](int i) const { return values[static_cast<size_t>(i) * step]; }
+    double first() const { return values[0]; }
+    double last() const { return (*this)[count - 1]; }
+    QVector<double> toVector() const;
+private:
+    const double *values;
+    int count;
+    int step;
+};
+// Paths are stored day-major in one allocation: all paths for day 0, then all
+// paths for day 1, ... so a day is contiguous and a path is a strided view.
+// The matrix lives in a std::vector because paths x days routinely exceeds
+// what an int-indexed QVector can address.
+class SimulationResult
+{
+public:
+    enum Scale
+    {
+        Price,
+        LogPrice
+    };
+    SimulationResult();
+    SimulationResult(int numPaths, int numDays);
+    int pathCount() const { return paths; }
+    int dayCount() const { return days; }
+    bool isEmpty() const { return paths == 0 || days == 0; }
+    // Column day offsets for horizon-only results; full runs store every day.
+    int dayOffset(int column) const { return offsets.isEmpty() ? column : offsets[column]; }
+    void setDayOffsets(const QVector<int> &dayOffsets) { offsets = dayOffsets; }
+    // Paths come in consecutive groups of this size that are only independent
+    // of each other as whole groups (2 for antithetic pairs).
+    int groupSize() const { return group; }
+    void setGroupSize(int size) { group = qMax(1, size); }
+    Scale scale() const { return valueScale; }
+    void setScale(Scale scale) { valueScale = scale; }
+    void toPrices();
+    double value(int path, int day) const { return values[static_cast<size_t>(day) * paths + path]; }
+    double *data() { return values.data(); }
+    const double *constData() const { return values.data(); }
+    double *dayData(int day) { return values.data() + static_cast<size_t>(day) * paths; }
+    const double *dayData(int day) const { return values.data() + static_cast<size_t>(day) * paths; }
+    SimulationView path(int path) const;
+    SimulationView day(int day) const;
+    double *likelihoodData() { return logLikelihoods.data(); }
+    const QVector<double> &likelihoods() const { return logLikelihoods; }
+    // Importance-sampled results carry a log likelihood-ratio weight per path;
+    // unweighted results have no weight storage and return null.
+    bool isWeighted() const { return !logWeightValues.isEmpty(); }
+    void enableWeights() { logWeightValues.fill(0.0, paths); }
+    double *logWeightData() { return isWeighted() ? logWeightValues.data() : nullptr; }
+    const QVector<double> &logWeights() const { return logWeightValues; }
+    double weight(int path) const;
+    int mostLikelyPath() const;
+    double quantile(int day, double probability) const;
+    // Copy of the first count paths with their likelihoods and weights.
+    SimulationResult firstPaths(int count) const;
+private:
+    int paths;
+    int days;
+    Scale valueScale;
+    int group;
+    QVector<int> offsets;
+    std::vector<double> values;
+    QVector<double> logLikelihoods;
+    QVector<double> logWeightValues;
+};
+// Per-day quantiles produced by the streaming engine, which never stores
+// individual paths.
+class QuantileSummary
+{
+public:
+    QuantileSummary();
+    QuantileSummary(int numDays, const QVector<double> &probabilities, qint64 numPaths);
+    int dayCount() const { return days; }
+    qint64 pathCount() const { return paths; }
+    const QVector<double> &probabilities() const { return levels; }
+    double value(int day, int level) const { return values[day * levels.size() + level]; }
+    void setValue(int day, int level, double value) { values[day * levels.size() + level] = value; }
+    QVector<double> band(int level) const;
+private:
+    int days;
+    qint64 paths;
+    QVector<double> levels;
+    QVector<double> values;
+};
+#endif
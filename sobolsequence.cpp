@@ -0,0 +1,99 @@
+#include "sobolsequence.h"
+#include "randomstream.h"
+namespace {
+const int bits = 32;
+// Degree, polynomial coefficients and initial direction numbers for
+// dimensions 2.. of the Joe-Kuo new-joe-kuo-6 table; dimension 1 is the van
+// der Corput sequence.
+struct Primitive
+{
+    int degree;
+    unsigned coefficients;
+    unsigned initial[7];
+};
+const Primitive primitives[] = {
+    {1, 0, {1}},
+    {2, 1, {1, 3}},
+    {3, 1, {1, 3, 1}},
+    {3, 2, {1, 1, 1}},
+    {4, 1, {1, 1, 3, 3}},
+    {4, 4, {1, 3, 5, 13}},
+    {5, 2, {1, 1, 5, 5, 17}},
+    {5, 4, {1, 1, 5, 5, 5}},
+    {5, 7, {1, 1, 7, 11, 19}},
+    {5, 11, {1, 1, 5, 1, 1}},
+    {5, 13, {1, 1, 1, 3, 11}},
+    {5, 14, {1, 3, 5, 5, 31}},
+    {6, 1, {1, 3, 3, 9, 7, 49}},
+    {6, 13, {1, 1, 1, 15, 21, 21}},
+    {6, 16, {1, 3, 1, 13, 27, 49}},
+    {6, 19, {1, 1, 1, 15, 7, 5}},
+    {6, 22, {1, 3, 1, 15, 13, 25}},
+    {6, 25, {1, 1, 5, 5, 19, 61}},
+    {7, 1, {1, 3, 7, 11, 23, 15, 103}},
+    {7, 4, {1, 3, 7, 13, 13, 15, 69}},
+};
+const int tableDimensions = sizeof(primitives) / sizeof(primitives[0]) + 1;
+int parity(quint32 value)
+{
+    return __builtin_parity(value);
+}
+}
+int SobolSequence::maxDimensions()
+{
+    return tableDimensions;
+}
+SobolSequence::SobolSequence(int dimensions, quint64 scrambleSeed)
+    : dims(qBound(1, dimensions, tableDimensions)), directions(dims * bits), shifts(dims)
+{
+    for (int k = 0; k < bits; ++k)
+        directions[k] = 1u << (bits - 1 - k);
+    for (int j = 1; j < dims; ++j)
+    {
+        const Primitive &p = primitives[j - 1];
+        quint32 *v = directions.data() + j * bits;
+        for (int k = 0; k < p.degree; ++k)
+            v[k] = p.initial[k] << (bits - 1 - k);
+        for (int k = p.degree; k < bits; ++k)
+        {
+            quint32 value = v[k - p.degree] ^ (v[k - p.degree] >> p.degree);
+            for (int i = 1; i < p.degree; ++i)
+                if ((p.coefficients >> (p.degree - 1 - i)) & 1)
+                    value ^= v[k - i];
+            v[k] = value;
+        }
+    }
+    // Linear matrix scramble: output digit b is the parity of the input
+    // digits selected by a random lower-triangular row with unit diagonal.
+    RandomStream stream(scrambleSeed, 0x536f626f6cULL);
+    for (int j = 0; j < dims; ++j)
+    {
+        quint32 rows[bits];
+        for (int b = 0; b < bits; ++b)
+        {
+            quint32 above = b == bits - 1 ? 0u : ~0u << (b + 1);
+            rows[b] = (static_cast<quint32>(stream.next()) & above) | (1u << b);
+        }
+        quint32 *v = directions.data() + j * bits;
+        for (int k = 0; k < bits; ++k)
+        {
+            quint32 scrambled = 0;
+            for (int b = 0; b < bits; ++b)
+                scrambled |= static_cast<quint32>(parity(rows[b] & v[k])) << b;
+            v[k] = scrambled;
+        }
+        shifts[j] = static_cast<quint32>(stream.next());
+    }
+}
+void SobolSequence::point(quint32 index, double *out) const
+{
+    quint32 gray = index ^ (index >> 1);
+    for (int j = 0; j < dims; ++j)
+    {
+        const quint32 *v = directions.constData() + j * bits;
+        quint32 x = shifts[j];
+        for (quint32 g = gray; g != 0; g &= g - 1)
+            x ^= v[__builtin_ctz(g)];
+        out[j] = (x + 0.5) * (1.0 / 4294967296.0);
+    }
+}
@@ -0,0 +1,21 @@
+#ifndef SOBOLSEQUENCE_H
+#define SOBOLSEQUENCE_H
+#include <QVector>
+// Sobol low-discrepancy points with Joe-Kuo direction numbers, randomised by
+// a linear matrix scramble plus a digital shift. Each seed gives an
+// independent, uniformly distributed replicate of the point set, which is
+// what randomised QMC error estimates rely on.
+class SobolSequence
+{
+public:
+    SobolSequence(int dimensions, quint64 scrambleSeed);
+    static int maxDimensions();
+    int dimensions() const { return dims; }
+    // Writes point `index` (0-based) as uniforms in (0, 1).
+    void point(quint32 index, double *out) const;
+private:
+    int dims;
+    QVector<quint32> directions;
+    QVector<quint32> shifts;
+};
+#endif
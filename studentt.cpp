@@ -0,0 +1,163 @@
+#include "studentt.h"
+#include "distributions.h"
+#include "simdkernels.h"
+#include <QtGlobal>
+#include <cmath>
+namespace {
+const int tableNodes = 4097;
+const double tableLimit = 6.0;
+const double tableSpacing = 2.0 * tableLimit / (tableNodes - 1);
+const double logSqrtTwoPi = 0.91893853320467274178;
+const double goldenRatio = 0.61803398874989484820;
+const double minDegrees = 2.1;
+const double maxDegrees = 200.0;
+const double maxSkew = 0.95;
+// Hansen's constants: the density is b c (1 + ((b x + a) / (1 -/+ skew))^2 /
+// (nu - 2))^-(nu + 1) / 2 on either side of x = -a / b.
+struct SkewConstants
+{
+    double a;
+    double b;
+    double logC;
+};
+SkewConstants skewConstants(const StudentTParameters &p)
+{
+    double nu = p.degreesOfFreedom;
+    SkewConstants k;
+    k.logC = lgamma(0.5 * (nu + 1.0)) - lgamma(0.5 * nu) - 0.5 * log(M_PI * (nu - 2.0));
+    k.a = 4.0 * p.skew * exp(k.logC) * (nu - 2.0) / (nu - 1.0);
+    k.b = sqrt(1.0 + 3.0 * p.skew * p.skew - k.a * k.a);
+    return k;
+}
+double logKernel(const StudentTParameters &p, const SkewConstants &k, double x)
+{
+    double y = (k.b * x + k.a) / (x < -k.a / k.b ? 1.0 - p.skew : 1.0 + p.skew);
+    return -0.5 * (p.degreesOfFreedom + 1.0) * log1p(y * y / (p.degreesOfFreedom - 2.0));
+}
+template <typename Function>
+double goldenMaximum(double low, double high, Function f)
+{
+    double x1 = high - goldenRatio * (high - low);
+    double x2 = low + goldenRatio * (high - low);
+    double f1 = f(x1), f2 = f(x2);
+    while (high - low > 1e-4)
+    {
+        if (f1 < f2)
+        {
+            low = x1;
+            x1 = x2;
+            f1 = f2;
+            x2 = low + goldenRatio * (high - low);
+            f2 = f(x2);
+        }
+        else
+        {
+            high = x2;
+            x2 = x1;
+            f2 = f1;
+            x1 = high - goldenRatio * (high - low);
+            f1 = f(x1);
+        }
+    }
+    return 0.5 * (low + high);
+}
+}
+namespace StudentT {
+StudentTParameters fit(const double *logReturns, int count, bool fitSkew)
+{
+    StudentTParameters parameters = {maxDegrees, 0.0};
+    if (count < 2)
+        return parameters;
+    double mean = 0.0;
+    for (int i = 0; i < count; ++i)
+        mean += logReturns[i];
+    mean /= count;
+    double variance = 0.0;
+    for (int i = 0; i < count; ++i)
+        variance += (logReturns[i] - mean) * (logReturns[i] - mean);
+    variance /= count;
+    if (variance <= 0.0)
+        return parameters;
+    QVector<double> centred(count);
+    for (int i = 0; i < count; ++i)
+        centred[i] = logReturns[i] - mean;
+    // The sample variance is a poor scale under heavy tails, so the scale is
+    // fitted alongside the shape; only the shape is kept.
+    double logScale = 0.5 * log(variance);
+    auto logLikelihood = [&](const StudentTParameters &trial, double trialLogScale) {
+        SkewConstants k = skewConstants(trial);
+        double inverseScale = exp(-trialLogScale);
+        double sum = count * (log(k.b) + k.logC - trialLogScale);
+        for (double value : centred)
+            sum += logKernel(trial, k, value * inverseScale);
+        return sum;
+    };
+    for (int round = 0; round < 4; ++round)
+    {
+        // The degrees of freedom are searched on log(nu - 2), where the
+        // likelihood is far closer to unimodal and evenly curved.
+        double s = goldenMaximum(log(minDegrees - 2.0), log(maxDegrees - 2.0), [&](double trial) {
+            StudentTParameters t = {2.0 + exp(trial), parameters.skew};
+            return logLikelihood(t, logScale);
+        });
+        parameters.degreesOfFreedom = 2.0 + exp(s);
+        logScale = goldenMaximum(logScale - 1.0, logScale + 1.0,
+                                 [&](double trial) { return logLikelihood(parameters, trial); });
+        if (fitSkew)
+            parameters.skew = goldenMaximum(-maxSkew, maxSkew, [&](double trial) {
+                StudentTParameters t = {parameters.degreesOfFreedom, trial};
+                return logLikelihood(t, logScale);
+            });
+    }
+    return parameters;
+}
+}
+// The integration starts where Phi(z) = (1 - skew) / 2, whose image is the
+// split point -a / b, and runs outwards with one RK4 step per grid spacing.
+ShockTable::ShockTable(const StudentTParameters &parameters)
+{
+    const StudentTParameters &p = parameters;
+    const SkewConstants k = skewConstants(p);
+    const double logScale = log(k.b) + k.logC;
+    auto slope = [&](double z, double t) { return exp(-0.5 * z * z - logSqrtTwoPi - logScale - logKernel(p, k, t)); };
+    auto step = [&](double z, double t, double h) {
+        double k1 = slope(z, t);
+        double k2 = slope(z + 0.5 * h, t + 0.5 * h * k1);
+        double k3 = slope(z + 0.5 * h, t + 0.5 * h * k2);
+        double k4 = slope(z + h, t + h * k3);
+        return t + h * (k1 + 2.0 * k2 + 2.0 * k3 + k4) / 6.0;
+    };
+    QVector<double> values(tableNodes);
+    const double z0 = Distributions::inverseNormalCdf(0.5 * (1.0 - p.skew));
+    const int start = qBound(0, static_cast<int>(round((z0 + tableLimit) / tableSpacing)), tableNodes - 1);
+    values[start] = step(z0, -k.a / k.b, -tableLimit + start * tableSpacing - z0);
+    for (int i = start + 1; i < tableNodes; ++i)
+        values[i] = step(-tableLimit + (i - 1) * tableSpacing, values[i - 1], tableSpacing);
+    for (int i = start - 1; i >= 0; --i)
+        values[i] = step(-tableLimit + (i + 1) * tableSpacing, values[i + 1], -tableSpacing);
+    nodes.resize(2 * tableNodes);
+    for (int i = 0; i < tableNodes; ++i)
+    {
+        nodes[2 * i] = values[i];
+        nodes[2 * i + 1] = logKernel(p, k, values[i]);
+    }
+}
+void ShockTable::apply(double *shocks, int steps, int lanes, double *normalLogDensities, double *logDensities) const
+{
+    Simd::tabulatedShocks(shocks, steps, lanes, nodes.constData(), tableNodes, -tableLimit, tableSpacing,
+                          normalLogDensities, logDensities);
+}
+double ShockTable::meanExp(double scale) const
+{
+    if (nodes.isEmpty())
+        return exp(0.5 * scale * scale);
+    double tail = 0.5 * erfc(tableLimit / sqrt(2.0));
+    double sum = tail * (exp(scale * nodes[0]) + exp(scale * nodes[2 * (tableNodes - 1)]));
+    for (int i = 0; i < tableNodes; ++i)
+    {
+        double z = -tableLimit + i * tableSpacing;
+        double weight = (i == 0 || i == tableNodes - 1 ? 0.5 : 1.0) * tableSpacing;
+        sum += weight * exp(-0.5 * z * z - logSqrtTwoPi + scale * nodes[2 * i]);
+    }
+    return sum;
+}
@@ -0,0 +1,38 @@
+#ifndef STUDENTT_H
+#define STUDENTT_H
+#include <QVector>
+// Standardised (zero mean, unit variance) Student-t shocks, skewed as in
+// Hansen (1994) when skew is non-zero; skew lies in (-1, 1) and negative
+// values fatten the left tail.
+struct StudentTParameters
+{
+    double degreesOfFreedom;
+    double skew;
+};
+namespace StudentT {
+// Maximum likelihood fit to the demeaned log returns: golden-section
+// searches on the degrees of freedom, a scale and, when fitSkew is set, the
+// skew, taken in turn for a few rounds.
+StudentTParameters fit(const double *logReturns, int count, bool fitSkew);
+}
+// Maps standard normal shocks to t shocks with the same CDF value,
+// t = F^-1(Phi(z)). The map and the t log density along it are tabulated on
+// a uniform z grid, built by integrating dt/dz = phi(z) / f(t), and applied
+// to whole blocks with Simd::tabulatedShocks. Shocks beyond |z| = 6
+// (probability 2e-9) are clamped to the grid ends, which keeps E[exp(t)]
+// finite; the untruncated t has no exponential moments.
+class ShockTable
+{
+public:
+    ShockTable() {}
+    explicit ShockTable(const StudentTParameters &parameters);
+    bool isEmpty() const { return nodes.isEmpty(); }
+    // Transforms a step-major block in place; per lane, normalLogDensities
+    // receives the sum of -z^2/2 and logDensities the sum of t log densities.
+    void apply(double *shocks, int steps, int lanes, double *normalLogDensities, double *logDensities) const;
+    // E[exp(scale * t)] of the tabulated shock.
+    double meanExp(double scale) const;
+private:
+    QVector<double> nodes;
+};
+#endif
@@ -0,0 +1,123 @@
+#include "tdigest.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+namespace {
+const double pi = 3.14159265358979323846;
+}
+TDigest::TDigest(double compression)
+    : compression(compression), total(0.0), bufferedWeight(0.0),
+      minimum(std::numeric_limits<double>::infinity()), maximum(-std::numeric_limits<double>::infinity())
+{
+}
+void TDigest::add(double value)
+{
+    buffer.append(value);
+    bufferedWeight += 1.0;
+    minimum = qMin(minimum, value);
+    maximum = qMax(maximum, value);
+    if (buffer.size() >= static_cast<int>(4 * compression))
+        compress();
+}
+void TDigest::merge(const TDigest &other)
+{
+    if (other.totalWeight() == 0.0)
+        return;
+    compress();
+    QVector<Centroid> incoming = other.centroids;
+    for (double value : other.buffer)
+    {
+        Centroid point = {value, 1.0};
+        incoming.append(point);
+    }
+    std::sort(incoming.begin(), incoming.end(), [](const Centroid &a, const Centroid &b) {
+        return a.mean < b.mean;
+    });
+    minimum = qMin(minimum, other.minimum);
+    maximum = qMax(maximum, other.maximum);
+    total += other.totalWeight();
+    mergeCentroids(incoming);
+}
+void TDigest::compress()
+{
+    if (buffer.isEmpty())
+        return;
+    std::sort(buffer.begin(), buffer.end());
+    QVector<Centroid> incoming(buffer.size());
+    for (int i = 0; i < buffer.size(); ++i)
+    {
+        incoming[i].mean = buffer[i];
+        incoming[i].weight = 1.0;
+    }
+    total += bufferedWeight;
+    bufferedWeight = 0.0;
+    buffer.clear();
+    mergeCentroids(incoming);
+}
+// Merges sorted incoming centroids into the digest; total must already
+// include their weight.
+void TDigest::mergeCentroids(const QVector<Centroid> &incoming)
+{
+    QVector<Centroid> sorted(incoming.size() + centroids.size());
+    std::merge(incoming.begin(), incoming.end(), centroids.begin(), centroids.end(), sorted.begin(),
+               [](const Centroid &a, const Centroid &b) { return a.mean < b.mean; });
+    // k(q) = compression / (2 pi) * asin(2q - 1); a centroid may grow until
+    // its right edge is one unit of k past its left edge. With x = 2q - 1 and
+    // d = 2 pi / compression that edge is sin(asin(x) + d), expanded below so
+    // no trigonometry runs per centroid.
+    const double step = 2.0 * pi / compression;
+    const double cosStep = cos(step);
+    const double sinStep = sin(step);
+    auto limitFor = [&](double weightSoFar) {
+        double x = qBound(-1.0, 2.0 * weightSoFar / total - 1.0, 1.0);
+        if (x >= cosStep)
+            return total;
+        return total * (x * cosStep + sqrt(1.0 - x * x) * sinStep + 1.0) / 2.0;
+    };
+    centroids.clear();
+    Centroid current = sorted[0];
+    double weightSoFar = 0.0;
+    double limit = limitFor(0.0);
+    for (int i = 1; i < sorted.size(); ++i)
+    {
+        const Centroid &next = sorted[i];
+        if (weightSoFar + current.weight + next.weight <= limit)
+        {
+            current.weight += next.weight;
+            current.mean += (next.mean - current.mean) * next.weight / current.weight;
+        }
+        else
+        {
+            centroids.append(current);
+            weightSoFar += current.weight;
+            limit = limitFor(weightSoFar);
+            current = next;
+        }
+    }
+    centroids.append(current);
+}
+double TDigest::quantile(double probability)
+{
+    compress();
+    if (centroids.isEmpty())
+        return std::numeric_limits<double>::quiet_NaN();
+    if (centroids.size() == 1)
+        return centroids[0].mean;
+    double target = qBound(0.0, probability, 1.0) * total;
+    const Centroid &first = centroids.first();
+    if (target < first.weight / 2.0)
+        return minimum + (first.mean - minimum) * target / (first.weight / 2.0);
+    double cumulative = first.weight / 2.0;
+    for (int i = 0; i + 1 < centroids.size(); ++i)
+    {
+        const Centroid &left = centroids[i];
+        const Centroid &right = centroids[i + 1];
+        double gap = (left.weight + right.weight) / 2.0;
+        if (target < cumulative + gap)
+            return left.mean + (right.mean - left.mean) * (target - cumulative) / gap;
+        cumulative += gap;
+    }
+    const Centroid &last = centroids.last();
+    double tail = last.weight / 2.0;
+    return last.mean + (maximum - last.mean) * qMin(1.0, (target - cumulative) / tail);
+}
@@ -0,0 +1,33 @@
+#ifndef TDIGEST_H
+#define TDIGEST_H
+#include <QVector>
+// Merging t-digest (Dunning & Ertl) with the arcsine scale function. Memory is
+// bounded by the compression parameter regardless of how many values are
+// added, and two digests can be merged, so per-thread sketches combine into
+// one summary.
+class TDigest
+{
+public:
+    explicit TDigest(double compression = 100.0);
+    void add(double value);
+    void merge(const TDigest &other);
+    void compress();
+    double quantile(double probability);
+    double totalWeight() const { return total + bufferedWeight; }
+    int centroidCount() const { return centroids.size(); }
+private:
+    struct Centroid
+    {
+        double mean;
+        double weight;
+    };
+    double compression;
+    double total;
+    double bufferedWeight;
+    double minimum;
+    double maximum;
+    QVector<Centroid> centroids;
+    QVector<double> buffer;
+    void mergeCentroids(const QVector<Centroid> &incoming);
+};
+#endif
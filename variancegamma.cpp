@@ -0,0 +1,143 @@
+#include "variancegamma.h"
+#include "simdkernels.h"
+#include <QtGlobal>
+#include <algorithm>
+#include <cmath>
+namespace {
+const quint64 clockStreamSalt = 0x56617247616D6D61ULL;
+const double minimumVarianceRate = 1e-4;
+const double maximumVarianceRate = 50.0;
+const int fitIterations = 100;
+}
+namespace VarianceGamma {
+VarianceGammaParameters fit(const double *logReturns, int count)
+{
+    VarianceGammaParameters parameters = {0.0, 0.0, 0.0, minimumVarianceRate};
+    if (count <= 0)
+        return parameters;
+    double mean = 0.0;
+    for (int i = 0; i < count; ++i)
+        mean += logReturns[i];
+    mean /= count;
+    double variance = 0.0, third = 0.0, fourth = 0.0;
+    for (int i = 0; i < count; ++i)
+    {
+        double d = logReturns[i] - mean;
+        double square = d * d;
+        variance += square;
+        third += square * d;
+        fourth += square * square;
+    }
+    variance /= count;
+    third /= count;
+    fourth = fourth / count - 3.0 * variance * variance;
+    parameters.volatility = sqrt(variance);
+    if (count < 4 || variance <= 0.0 || fourth <= 0.0)
+    {
+        parameters.mean = mean;
+        return parameters;
+    }
+    double nu = qBound(minimumVarianceRate, fourth / (3.0 * variance * variance), maximumVarianceRate);
+    double theta = 0.0;
+    double sigma2 = variance;
+    for (int iteration = 0; iteration < fitIterations; ++iteration)
+    {
+        theta = third / (3.0 * sigma2 * nu + 2.0 * theta * theta * nu * nu);
+        double limit = sqrt(0.9 * variance / nu);
+        theta = qBound(-limit, theta, limit);
+        sigma2 = variance - theta * theta * nu;
+        double denominator = 3.0 * sigma2 * sigma2 + 12.0 * sigma2 * theta * theta * nu + 6.0 * pow(theta, 4) * nu * nu;
+        nu = qBound(minimumVarianceRate, fourth / denominator, maximumVarianceRate);
+    }
+    while (1.0 - theta * nu - 0.5 * sigma2 * nu <= 0.0 && nu > minimumVarianceRate)
+        nu *= 0.5;
+    parameters.volatility = sqrt(sigma2);
+    parameters.skew = theta;
+    parameters.varianceRate = nu;
+    parameters.mean = mean;
+    return parameters;
+}
+double compensator(const VarianceGammaParameters &parameters)
+{
+    const double nu = parameters.varianceRate;
+    const double sigma = parameters.volatility;
+    return log(1.0 - parameters.skew * nu - 0.5 * sigma * sigma * nu) / nu;
+}
+double expectedGrowth(const VarianceGammaParameters &parameters, double days)
+{
+    return exp(parameters.mean * days);
+}
+}
+VarianceGammaSampler::VarianceGammaSampler(const VarianceGammaParameters &parameters, quint64 seed, bool antithetic,
+                                           RandomStream::Generator generator, const QVector<double> &stepLengths)
+    : varianceRate(parameters.varianceRate), streamSeed(seed ^ clockStreamSalt), pairs(antithetic), engine(generator),
+      stepCount(stepLengths.size())
+{
+    for (int i = 0; i < stepCount; ++i)
+        if (i == 0 || stepLengths[i] != stepLengths[i - 1])
+        {
+            runStarts.append(i);
+            runShapes.append(stepLengths[i] / varianceRate);
+        }
+    runStarts.append(stepCount);
+}
+double VarianceGammaSampler::fill(qint64 path, double *times, double *workspace) const
+{
+    RandomStream stream(streamSeed, pairs ? path / 2 : path, engine);
+    double *normals = workspace;
+    double *uniforms = normals + stepCount;
+    double *boosts = uniforms + stepCount;
+    double *logTimes = boosts + stepCount;
+    double *retried = logTimes + stepCount;
+    double *retriedLogs = retried + stepCount;
+    int *rejected = reinterpret_cast<int *>(retriedLogs + stepCount);
+    double logDensity = 0.0;
+    for (int run = 0; run + 1 < runStarts.size(); ++run)
+    {
+        const int first = runStarts[run];
+        const int count = runStarts[run + 1] - first;
+        const double shape = runShapes[run];
+        if (shape <= 0.0)
+        {
+            std::fill(times + first, times + first + count, 0.0);
+            continue;
+        }
+        stream.fillNormals(normals, count);
+        stream.fillUniforms(uniforms, count);
+        if (shape < 1.0)
+            stream.fillUniforms(boosts, count);
+        Simd::gammaVariates(normals, uniforms, boosts, count, shape, varianceRate, times + first, logTimes + first);
+        int pending = 0;
+        for (int i = first; i < first + count; ++i)
+            if (times[i] < 0.0)
+                rejected[pending++] = i;
+        while (pending > 0)
+        {
+            stream.fillNormals(normals, pending);
+            stream.fillUniforms(uniforms, pending);
+            if (shape < 1.0)
+                stream.fillUniforms(boosts, pending);
+            Simd::gammaVariates(normals, uniforms, boosts, pending, shape, varianceRate, retried, retriedLogs);
+            int left = 0;
+            for (int i = 0; i < pending; ++i)
+            {
+                if (retried[i] < 0.0)
+                {
+                    rejected[left++] = rejected[i];
+                    continue;
+                }
+                times[rejected[i]] = retried[i];
+                logTimes[rejected[i]] = retriedLogs[i];
+            }
+            pending = left;
+        }
+        double sum = 0.0, logSum = 0.0;
+        for (int i = first; i < first + count; ++i)
+        {
+            sum += times[i];
+            logSum += logTimes[i];
+        }
+        logDensity += (shape - 1.0) * logSum - sum / varianceRate;
+    }
+    return logDensity;
+}
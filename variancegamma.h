@@ -0,0 +1,53 @@
+#ifndef VARIANCEGAMMA_H
+#define VARIANCEGAMMA_H
+#include <QVector>
+#include "randomstream.h"
+// Variance gamma: Brownian motion with drift skew and the given volatility,
+// run on a gamma clock whose increments over t days have mean t and
+// variance varianceRate * t. The log price moves by mean + omega plus that
+// pure-jump increment, where omega = log(1 - skew * varianceRate -
+// volatility^2 * varianceRate / 2) / varianceRate compensates it, so
+// E[S_t / S_0] = exp(mean * t) as under GBM.
+struct VarianceGammaParameters
+{
+    double mean;
+    double volatility;
+    double skew;
+    double varianceRate;
+};
+namespace VarianceGamma {
+// Method of moments: the variance, skewness and excess kurtosis of the daily
+// log returns are matched by fixed-point iteration, and mean is their sample
+// mean so expected growth agrees with GBM. Returns without excess kurtosis
+// give a tiny varianceRate, which is GBM in all but name.
+VarianceGammaParameters fit(const double *logReturns, int count);
+double compensator(const VarianceGammaParameters &parameters);
+double expectedGrowth(const VarianceGammaParameters &parameters, double days);
+}
+// Draws the gamma time change of every step of a path. Like JumpSampler every
+// path is a pure function of the seed and its index and antithetic pairs
+// share their clock. Steps of equal length are drawn together as one bulk
+// batch of Simd::gammaVariates candidates, and only the few rejected ones
+// are redrawn.
+class VarianceGammaSampler
+{
+public:
+    VarianceGammaSampler(const VarianceGammaParameters &parameters, quint64 seed, bool antithetic,
+                         RandomStream::Generator generator, const QVector<double> &stepLengths);
+    int steps() const { return stepCount; }
+    // Doubles of caller-owned scratch that fill needs.
+    int workspaceSize() const { return 7 * stepCount; }
+    // Writes the time change of each step and returns the sum of their log
+    // gamma densities (without the normalising constants). Steps of length 0
+    // get no time and no density.
+    double fill(qint64 path, double *times, double *workspace) const;
+private:
+    double varianceRate;
+    quint64 streamSeed;
+    bool pairs;
+    RandomStream::Generator engine;
+    int stepCount;
+    QVector<int> runStarts;
+    QVector<double> runShapes;
+};
+#endif
@@ -0,0 +1,74 @@
+#include "volatility.h"
+#include <cmath>
+namespace {
+const double ln2 = 0.69314718055994530942;
+}
+VolatilityEstimates::VolatilityEstimates(double ewmaLambda)
+    : lambda(ewmaLambda), lastClose(0.0), returns(0), returnMean(0.0), returnSquares(0.0), ewmaVariance(0.0),
+      ranges(0), parkinsonSum(0.0), garmanKlassSum(0.0)
+{
+}
+VolatilityEstimates VolatilityEstimates::fromBars(const QVector<PriceBar> &bars, double ewmaLambda)
+{
+    VolatilityEstimates estimates(ewmaLambda);
+    for (const PriceBar &bar : bars)
+        estimates.add(bar);
+    return estimates;
+}
+const char *VolatilityEstimates::estimatorName(Estimator estimator)
+{
+    switch (estimator)
+    {
+    case Ewma:
+        return "EWMA";
+    case Parkinson:
+        return "Parkinson";
+    case GarmanKlass:
+        return "Garman-Klass";
+    default:
+        return "Close-to-Close";
+    }
+}
+void VolatilityEstimates::add(const PriceBar &bar)
+{
+    if (bar.low > 0.0 && bar.open > 0.0 && bar.high >= bar.low && bar.close > 0.0)
+    {
+        double range = log(bar.high / bar.low);
+        double body = log(bar.close / bar.open);
+        parkinsonSum += range * range;
+        garmanKlassSum += 0.5 * range * range - (2.0 * ln2 - 1.0) * body * body;
+        ++ranges;
+    }
+    addClose(bar.close);
+}
+void VolatilityEstimates::addClose(double close)
+{
+    if (lastClose > 0.0 && close > 0.0)
+    {
+        double value = log(close / lastClose);
+        ++returns;
+        double delta = value - returnMean;
+        returnMean += delta / returns;
+        returnSquares += delta * (value - returnMean);
+        ewmaVariance = returns == 1 ? value * value : lambda * ewmaVariance + (1.0 - lambda) * value * value;
+    }
+    lastClose = close;
+}
+double VolatilityEstimates::variance(Estimator estimator) const
+{
+    switch (estimator)
+    {
+    case Ewma:
+        return ewmaVariance;
+    case Parkinson:
+        return ranges > 0 ? parkinsonSum / (4.0 * ln2 * ranges) : 0.0;
+    case GarmanKlass:
+        return ranges > 0 ? qMax(0.0, garmanKlassSum / ranges) : 0.0;
+    default:
+        return returns > 0 ? returnSquares / returns : 0.0;
+    }
+}
+double VolatilityEstimates::volatility(Estimator estimator) const
+{
+    return sqrt(variance(estimator));
+}
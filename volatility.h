@@ -0,0 +1,51 @@
+#ifndef VOLATILITY_H
+#define VOLATILITY_H
+#include <QVector>
+struct PriceBar
+{
+    double open;
+    double high;
+    double low;
+    double close;
+};
+// Daily variance estimators fed one bar at a time, all updated together so a
+// single pass over the history produces every one of them:
+//  - CloseToClose: equally weighted variance of log returns.
+//  - Ewma: RiskMetrics exponentially weighted variance, seeded with the first
+//    squared return.
+//  - Parkinson: high-low range estimator.
+//  - GarmanKlass: open-high-low-close estimator.
+// Bars with a missing or inconsistent range only feed the close-based ones.
+class VolatilityEstimates
+{
+public:
+    enum Estimator
+    {
+        CloseToClose,
+        Ewma,
+        Parkinson,
+        GarmanKlass
+    };
+    explicit VolatilityEstimates(double ewmaLambda = 0.94);
+    static VolatilityEstimates fromBars(const QVector<PriceBar> &bars, double ewmaLambda = 0.94);
+    static const char *estimatorName(Estimator estimator);
+    void add(const PriceBar &bar);
+    void addClose(double close);
+    int returnCount() const { return returns; }
+    double meanReturn() const { return returnMean; }
+    double squaredDeviations() const { return returnSquares; }
+    bool hasRanges() const { return ranges > 0; }
+    double variance(Estimator estimator) const;
+    double volatility(Estimator estimator) const;
+private:
+    double lambda;
+    double lastClose;
+    int returns;
+    double returnMean;
+    double returnSquares;
+    double ewmaVariance;
+    int ranges;
+    double parkinsonSum;
+    double garmanKlassSum;
+};
+#endif